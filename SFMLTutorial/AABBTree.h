@@ -0,0 +1,545 @@
+#pragma once
+
+#include "pch.h"
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <math.h>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Dynamic bounding volume tree: every leaf holds a box and a value, every inner node the union of its children.
+     * Leaf boxes are fattened by a margin, so a box moving a little within its fat box doesn't touch the tree.
+     * The tree is kept balanced by rotations, queries visit O(log n) nodes.
+     */
+    template <typename T>
+    class AABBTree
+    {
+    public:
+        static constexpr int NULL_NODE = -1;
+
+        /**
+         * @param margin: added to every side of the leaf boxes (in pixels).
+         */
+        explicit AABBTree(float margin) : root_(NULL_NODE), free_list_(NULL_NODE), margin_(margin), count_(0)
+        {
+        }
+
+        /**
+         * \brief Add a box.
+         * @return id of the leaf, to move or remove it.
+         */
+        int CreateProxy(const sf::FloatRect& bounds, const T& value)
+        {
+            int proxy = AllocateNode();
+            nodes_[proxy].box_ = Fatten(bounds);
+            nodes_[proxy].value_ = value;
+            nodes_[proxy].height_ = 0;
+            InsertLeaf(proxy);
+            ++count_;
+            return proxy;
+        }
+
+        void DestroyProxy(int proxy)
+        {
+            RemoveLeaf(proxy);
+            FreeNode(proxy);
+            --count_;
+        }
+
+        /**
+         * \brief Update the box of a leaf, it is only re-inserted if it left its fat box.
+         * @return true: if the leaf was re-inserted.
+         */
+        bool MoveProxy(int proxy, const sf::FloatRect& bounds)
+        {
+            if (Contains(nodes_[proxy].box_, bounds))
+                return false;
+
+            RemoveLeaf(proxy);
+            nodes_[proxy].box_ = Fatten(bounds);
+            InsertLeaf(proxy);
+            return true;
+        }
+
+        const T& GetValue(int proxy) const
+        {
+            return nodes_[proxy].value_;
+        }
+
+        /**
+         * \brief Remove every leaf.
+         */
+        void Clear()
+        {
+            nodes_.clear();
+            root_ = NULL_NODE;
+            free_list_ = NULL_NODE;
+            count_ = 0;
+        }
+
+        /**
+         * \brief Call a function for every leaf whose fat box overlaps an area.
+         * @param function: bool(const T&), return false to stop the query.
+         */
+        template <typename Function>
+        void Query(const sf::FloatRect& area, Function function) const
+        {
+            NodeStack stack;
+            stack.Push(root_);
+            while (!stack.IsEmpty())
+            {
+                int index = stack.Pop();
+                if (index == NULL_NODE || !Overlaps(nodes_[index].box_, area))
+                    continue;
+
+                const Node& node = nodes_[index];
+                if (node.IsLeaf())
+                {
+                    if (!function(node.value_))
+                        return;
+                }
+                else
+                {
+                    stack.Push(node.child1_);
+                    stack.Push(node.child2_);
+                }
+            }
+        }
+
+        /**
+         * \brief Call a function for every leaf whose fat box the segment [from, to] goes through.
+         * @param function: float(const T&, float maxFraction), return the new max fraction of the segment
+         * (e.g. the fraction of the hit to only look for closer hits, 0 to stop).
+         */
+        template <typename Function>
+        void RayCast(const sf::Vector2f& from, const sf::Vector2f& to, Function function) const
+        {
+            float maxFraction = 1.0f;
+            NodeStack stack;
+            stack.Push(root_);
+            while (!stack.IsEmpty())
+            {
+                int index = stack.Pop();
+                if (index == NULL_NODE)
+                    continue;
+
+                const Node& node = nodes_[index];
+                float fraction;
+                if (!IntersectSegment(node.box_, from, to, maxFraction, fraction))
+                    continue;
+
+                if (node.IsLeaf())
+                {
+                    maxFraction = function(node.value_, maxFraction);
+                    if (maxFraction <= 0.0f)
+                        return;
+                }
+                else
+                {
+                    stack.Push(node.child1_);
+                    stack.Push(node.child2_);
+                }
+            }
+        }
+
+        /**
+         * \brief Get the leaves closest to a point, closest first.
+         * @param distance: float(const T&), squared distance of a value to the point, negative to skip the value.
+         * It must not be smaller than the squared distance to the leaf box.
+         * @param count: maximum number of values.
+         */
+        template <typename Function>
+        void FindNearest(const sf::Vector2f& point, unsigned int count, Function distance, std::vector<T>& result) const
+        {
+            // best-first search: nodes by distance to their box, leaves again by the distance to their value.
+            struct Candidate
+            {
+                float distance_;
+                int index_;
+                bool is_exact_; // distance to the value rather than to the box?
+
+                bool operator<(const Candidate& other) const
+                {
+                    return distance_ > other.distance_; // std::priority_queue pops the biggest.
+                }
+            };
+
+            std::priority_queue<Candidate> queue;
+            if (root_ != NULL_NODE)
+                queue.push(Candidate{GetSquaredDistance(nodes_[root_].box_, point), root_, false});
+
+            while (!queue.empty() && result.size() < count)
+            {
+                Candidate candidate = queue.top();
+                queue.pop();
+
+                const Node& node = nodes_[candidate.index_];
+                if (candidate.is_exact_)
+                {
+                    result.emplace_back(node.value_);
+                }
+                else if (node.IsLeaf())
+                {
+                    float valueDistance = distance(node.value_);
+                    if (valueDistance >= 0.0f)
+                        queue.push(Candidate{valueDistance, candidate.index_, true});
+                }
+                else
+                {
+                    queue.push(Candidate{GetSquaredDistance(nodes_[node.child1_].box_, point), node.child1_, false});
+                    queue.push(Candidate{GetSquaredDistance(nodes_[node.child2_].box_, point), node.child2_, false});
+                }
+            }
+        }
+
+        unsigned int GetCount() const
+        {
+            return count_;
+        }
+
+        /**
+         * \brief Intersect the segment [from, to] with a box (slab test).
+         * @param maxFraction: only look up to this fraction of the segment.
+         * @param fraction: fraction of the segment where it enters the box, 0 if from is inside.
+         */
+        static bool IntersectSegment(const sf::FloatRect& box, const sf::Vector2f& from, const sf::Vector2f& to,
+                                     float maxFraction, float& fraction)
+        {
+            float entry = 0.0f;
+            float exit = maxFraction;
+            const float start[2] = {from.x, from.y};
+            const float delta[2] = {to.x - from.x, to.y - from.y};
+            const float boxMin[2] = {box.left, box.top};
+            const float boxMax[2] = {box.left + box.width, box.top + box.height};
+            for (int axis = 0; axis < 2; axis++)
+            {
+                if (delta[axis] == 0)
+                {
+                    if (start[axis] < boxMin[axis] || start[axis] > boxMax[axis])
+                        return false;
+                    continue;
+                }
+
+                float nearFraction = (boxMin[axis] - start[axis]) / delta[axis];
+                float farFraction = (boxMax[axis] - start[axis]) / delta[axis];
+                if (nearFraction > farFraction)
+                    std::swap(nearFraction, farFraction);
+
+                entry = std::max(entry, nearFraction);
+                exit = std::min(exit, farFraction);
+                if (entry > exit)
+                    return false;
+            }
+
+            fraction = entry;
+            return true;
+        }
+
+    private:
+        struct Node
+        {
+            sf::FloatRect box_; // fat box of a leaf, union of the children of an inner node.
+            T value_;
+            int parent_; // next free node when the node is free.
+            int child1_;
+            int child2_;
+            int height_; // 0: leaf, -1: free.
+
+            bool IsLeaf() const
+            {
+                return child1_ == NULL_NODE;
+            }
+        };
+
+        /**
+         * \brief Nodes left to visit by a traversal. The first STACK_SIZE are kept in the object, which is more
+         * than a balanced tree ever needs, so the queries made every frame don't touch the heap.
+         */
+        class NodeStack
+        {
+        public:
+            NodeStack() : count_(0)
+            {
+            }
+
+            void Push(int index)
+            {
+                if (count_ < STACK_SIZE)
+                    fixed_[count_] = index;
+                else
+                    overflow_.emplace_back(index);
+                ++count_;
+            }
+
+            int Pop()
+            {
+                --count_;
+                if (count_ < STACK_SIZE)
+                    return fixed_[count_];
+
+                int index = overflow_.back();
+                overflow_.pop_back();
+                return index;
+            }
+
+            bool IsEmpty() const
+            {
+                return count_ == 0;
+            }
+
+        private:
+            static constexpr unsigned int STACK_SIZE = 256;
+
+            int fixed_[STACK_SIZE];
+            std::vector<int> overflow_; // nodes past STACK_SIZE.
+            unsigned int count_;
+        };
+
+        std::vector<Node> nodes_;
+        int root_;
+        int free_list_;
+        float margin_;
+        unsigned int count_; // number of leaves.
+
+        int AllocateNode()
+        {
+            if (free_list_ == NULL_NODE)
+            {
+                nodes_.emplace_back();
+                nodes_.back().parent_ = NULL_NODE;
+                nodes_.back().height_ = -1;
+                free_list_ = static_cast<int>(nodes_.size()) - 1;
+            }
+
+            int index = free_list_;
+            Node& node = nodes_[index];
+            free_list_ = node.parent_;
+            node.parent_ = NULL_NODE;
+            node.child1_ = NULL_NODE;
+            node.child2_ = NULL_NODE;
+            node.height_ = 0;
+            return index;
+        }
+
+        void FreeNode(int index)
+        {
+            nodes_[index].parent_ = free_list_;
+            nodes_[index].height_ = -1;
+            nodes_[index].value_ = T();
+            free_list_ = index;
+        }
+
+        /**
+         * \brief Insert a leaf next to the sibling which grows the perimeter of the tree the least.
+         */
+        void InsertLeaf(int leaf)
+        {
+            if (root_ == NULL_NODE)
+            {
+                root_ = leaf;
+                nodes_[leaf].parent_ = NULL_NODE;
+                return;
+            }
+
+            const sf::FloatRect leafBox = nodes_[leaf].box_;
+            int index = root_;
+            while (!nodes_[index].IsLeaf())
+            {
+                const Node& node = nodes_[index];
+                float perimeter = GetPerimeter(node.box_);
+                float combinedPerimeter = GetPerimeter(Combine(node.box_, leafBox));
+
+                // cost of a new parent for this node and the leaf, and of pushing the leaf further down.
+                float cost = 2.0f * combinedPerimeter;
+                float inheritanceCost = 2.0f * (combinedPerimeter - perimeter);
+                float cost1 = GetDescentCost(node.child1_, leafBox) + inheritanceCost;
+                float cost2 = GetDescentCost(node.child2_, leafBox) + inheritanceCost;
+                if (cost < cost1 && cost < cost2)
+                    break;
+
+                index = (cost1 < cost2 ? node.child1_ : node.child2_);
+            }
+
+            int sibling = index;
+            int oldParent = nodes_[sibling].parent_;
+            int newParent = AllocateNode();
+            nodes_[newParent].parent_ = oldParent;
+            nodes_[newParent].box_ = Combine(leafBox, nodes_[sibling].box_);
+            nodes_[newParent].height_ = nodes_[sibling].height_ + 1;
+            nodes_[newParent].child1_ = sibling;
+            nodes_[newParent].child2_ = leaf;
+            nodes_[sibling].parent_ = newParent;
+            nodes_[leaf].parent_ = newParent;
+
+            if (oldParent == NULL_NODE)
+                root_ = newParent;
+            else if (nodes_[oldParent].child1_ == sibling)
+                nodes_[oldParent].child1_ = newParent;
+            else
+                nodes_[oldParent].child2_ = newParent;
+
+            Refit(nodes_[leaf].parent_);
+        }
+
+        void RemoveLeaf(int leaf)
+        {
+            if (leaf == root_)
+            {
+                root_ = NULL_NODE;
+                return;
+            }
+
+            int parent = nodes_[leaf].parent_;
+            int grandParent = nodes_[parent].parent_;
+            int sibling = (nodes_[parent].child1_ == leaf ? nodes_[parent].child2_ : nodes_[parent].child1_);
+
+            // the sibling takes the place of the parent.
+            nodes_[sibling].parent_ = grandParent;
+            FreeNode(parent);
+            if (grandParent == NULL_NODE)
+            {
+                root_ = sibling;
+                return;
+            }
+
+            if (nodes_[grandParent].child1_ == parent)
+                nodes_[grandParent].child1_ = sibling;
+            else
+                nodes_[grandParent].child2_ = sibling;
+
+            Refit(grandParent);
+        }
+
+        /**
+         * \brief Balance and update the boxes and heights from a node up to the root.
+         */
+        void Refit(int index)
+        {
+            while (index != NULL_NODE)
+            {
+                index = Balance(index);
+
+                Node& node = nodes_[index];
+                node.height_ = 1 + std::max(nodes_[node.child1_].height_, nodes_[node.child2_].height_);
+                node.box_ = Combine(nodes_[node.child1_].box_, nodes_[node.child2_].box_);
+                index = node.parent_;
+            }
+        }
+
+        /**
+         * \brief Rotate a node with its higher child when its children heights differ by more than one.
+         * @return index of the node now at the place of the given node.
+         */
+        int Balance(int indexA)
+        {
+            Node& a = nodes_[indexA];
+            if (a.IsLeaf() || a.height_ < 2)
+                return indexA;
+
+            int indexB = a.child1_;
+            int indexC = a.child2_;
+            int balance = nodes_[indexC].height_ - nodes_[indexB].height_;
+            if (balance > 1)
+                return Rotate(indexA, indexC, indexB);
+            if (balance < -1)
+                return Rotate(indexA, indexB, indexC);
+            return indexA;
+        }
+
+        /**
+         * \brief Move the higher child up to the place of its parent.
+         * @param indexA: parent, indexUp: its higher child, indexOther: its other child.
+         */
+        int Rotate(int indexA, int indexUp, int indexOther)
+        {
+            Node& a = nodes_[indexA];
+            Node& up = nodes_[indexUp];
+            int indexF = up.child1_;
+            int indexG = up.child2_;
+
+            // up takes the place of a.
+            up.child1_ = indexA;
+            up.parent_ = a.parent_;
+            a.parent_ = indexUp;
+            if (up.parent_ == NULL_NODE)
+                root_ = indexUp;
+            else if (nodes_[up.parent_].child1_ == indexA)
+                nodes_[up.parent_].child1_ = indexUp;
+            else
+                nodes_[up.parent_].child2_ = indexUp;
+
+            // the higher grand child stays under up, the other one goes under a.
+            if (nodes_[indexF].height_ < nodes_[indexG].height_)
+                std::swap(indexF, indexG);
+
+            up.child2_ = indexF;
+            if (a.child1_ == indexUp)
+                a.child1_ = indexG;
+            else
+                a.child2_ = indexG;
+            nodes_[indexG].parent_ = indexA;
+
+            a.box_ = Combine(nodes_[indexOther].box_, nodes_[indexG].box_);
+            a.height_ = 1 + std::max(nodes_[indexOther].height_, nodes_[indexG].height_);
+            up.box_ = Combine(a.box_, nodes_[indexF].box_);
+            up.height_ = 1 + std::max(a.height_, nodes_[indexF].height_);
+            return indexUp;
+        }
+
+        /**
+         * \brief Cost of inserting a box under a child, without the cost inherited from the parents.
+         */
+        float GetDescentCost(int child, const sf::FloatRect& box) const
+        {
+            float combinedPerimeter = GetPerimeter(Combine(box, nodes_[child].box_));
+            if (nodes_[child].IsLeaf())
+                return combinedPerimeter;
+            return combinedPerimeter - GetPerimeter(nodes_[child].box_);
+        }
+
+        sf::FloatRect Fatten(const sf::FloatRect& box) const
+        {
+            return sf::FloatRect(box.left - margin_, box.top - margin_, box.width + 2 * margin_,
+                                 box.height + 2 * margin_);
+        }
+
+        static sf::FloatRect Combine(const sf::FloatRect& first, const sf::FloatRect& second)
+        {
+            float left = std::min(first.left, second.left);
+            float top = std::min(first.top, second.top);
+            float right = std::max(first.left + first.width, second.left + second.width);
+            float bottom = std::max(first.top + first.height, second.top + second.height);
+            return sf::FloatRect(left, top, right - left, bottom - top);
+        }
+
+        static float GetPerimeter(const sf::FloatRect& box)
+        {
+            return 2.0f * (box.width + box.height);
+        }
+
+        static bool Contains(const sf::FloatRect& outer, const sf::FloatRect& inner)
+        {
+            return (outer.left <= inner.left && outer.top <= inner.top &&
+                outer.left + outer.width >= inner.left + inner.width &&
+                outer.top + outer.height >= inner.top + inner.height);
+        }
+
+        /**
+         * \brief Like sf::FloatRect::intersects, but touching boxes overlap.
+         */
+        static bool Overlaps(const sf::FloatRect& first, const sf::FloatRect& second)
+        {
+            return (first.left <= second.left + second.width && second.left <= first.left + first.width &&
+                first.top <= second.top + second.height && second.top <= first.top + first.height);
+        }
+
+        static float GetSquaredDistance(const sf::FloatRect& box, const sf::Vector2f& point)
+        {
+            float dx = std::max(std::max(box.left - point.x, 0.0f), point.x - (box.left + box.width));
+            float dy = std::max(std::max(box.top - point.y, 0.0f), point.y - (box.top + box.height));
+            return dx * dx + dy * dy;
+        }
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Number of heap allocations made through the global operator new since the start, by every thread.
+     * The replaced operator new counting them is defined once, in SFMLTutorial.cpp.
+     */
+    class AllocationCounter
+    {
+    public:
+        static void Add()
+        {
+            GetCounter().fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static std::size_t GetCount()
+        {
+            return GetCounter().load(std::memory_order_relaxed);
+        }
+
+    private:
+        static std::atomic<std::size_t>& GetCounter()
+        {
+            static std::atomic<std::size_t> count(0); // constant initialized, usable before main.
+            return count;
+        }
+    };
+}
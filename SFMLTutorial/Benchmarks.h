@@ -0,0 +1,475 @@
+#pragma once
+
+#include "pch.h"
+#include "TileGrid.h"
+#include "EntityBase.h"
+#include "JobSystem.h"
+#include "Window.h"
+#include "Map.h"
+#include "Textbox.h"
+#include "FrameArena.h"
+#include "AllocationCounter.h"
+#include <unordered_map>
+#include <vector>
+#include <iostream>
+#include <random>
+#include <cmath>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Entity with a bounding box and nothing else, for the entity benchmarks.
+     */
+    class BenchmarkEntity : public EntityBase
+    {
+    public:
+        BenchmarkEntity(EntityManager* entityMgr) : EntityBase(entityMgr)
+        {
+            name_ = "BenchmarkEntity";
+            type_ = EntityType::PLAYER; // bodies of the players touch each other, so every overlap is a contact.
+        }
+
+        void Draw(sf::RenderWindow* window) override
+        {
+        }
+
+    protected:
+        void HandleCollisionWithOtherEntity(EntityBase* collider, bool isAttack) override
+        {
+        }
+    };
+
+    /**
+     * \brief Headless benchmarks run from the command line (see main), they print their timings to std::cout.
+     */
+    class Benchmarks
+    {
+    public:
+        /**
+         * \brief Compare the tile grid with the tile map it replaced (unordered_map<TileID, Tile*>, a Tile per cell):
+         * looking up every cell, then drawing a view space tile by tile against chunk by chunk.
+         * @param size: map size in tiles per side, two tiles out of three are placed.
+         */
+        static bool RunTileGrid(unsigned int size)
+        {
+            if (size == 0)
+                return false;
+
+            sf::Texture texture; // stands in for the tile sheet.
+            if (!texture.create(SHEET_WIDTH, SHEET_HEIGHT))
+                return false;
+
+            SharedContext context;
+            TileInfo properties(&context);
+            properties.sprite_.setTexture(texture);
+            properties.sprite_.setTextureRect(sf::IntRect(0, 0, TILE_SIZE, TILE_SIZE));
+
+            TileGrid grid;
+            grid.Resize(sf::Vector2u(size, size));
+            std::unordered_map<TileID, Tile*> tileMap; // the old storage, keyed by x * size + y.
+            for (unsigned int x = 0; x < size; x++)
+            {
+                for (unsigned int y = 0; y < size; y++)
+                {
+                    if ((x * 7 + y * 13) % 3 == 0)
+                        continue;
+
+                    grid.AddTile(x, y, &properties);
+                    Tile* tile = new Tile();
+                    tile->properties_ = &properties;
+                    tileMap.emplace(x * size + y, tile);
+                }
+            }
+
+            std::cout << "tile grid: " << size << "x" << size << " cells, " << grid.GetTileCount() << " tiles"
+                << std::endl;
+
+            // lookups, the cost of Map::GetTile in draw and collision loops.
+            const unsigned int passes = 10;
+            unsigned int found = 0;
+            sf::Clock clock;
+            for (unsigned int pass = 0; pass < passes; pass++)
+            {
+                for (unsigned int x = 0; x < size; x++)
+                {
+                    for (unsigned int y = 0; y < size; y++)
+                    {
+                        found += (grid.GetTile(x, y) != nullptr);
+                    }
+                }
+            }
+            sf::Time gridTime = clock.restart();
+
+            for (unsigned int pass = 0; pass < passes; pass++)
+            {
+                for (unsigned int x = 0; x < size; x++)
+                {
+                    for (unsigned int y = 0; y < size; y++)
+                    {
+                        found += (tileMap.find(x * size + y) != tileMap.end());
+                    }
+                }
+            }
+            sf::Time mapTime = clock.restart();
+
+            const double lookups = static_cast<double>(passes) * size * size;
+            std::cout << "lookups: tile grid " << gridTime.asMicroseconds() * 1000.0 / lookups << " ns, "
+                << "unordered_map " << mapTime.asMicroseconds() * 1000.0 / lookups << " ns per cell ("
+                << found / 2 / passes << " found)" << std::endl;
+
+            // drawing a window-sized view space scrolled over the map, off screen.
+            sf::RenderTexture target;
+            if (!target.create(VIEW_WIDTH, VIEW_HEIGHT))
+                return false;
+
+            const unsigned int frames = 200;
+            const unsigned int viewTilesX = VIEW_WIDTH / TILE_SIZE + 1;
+            const unsigned int viewTilesY = VIEW_HEIGHT / TILE_SIZE + 1;
+            const unsigned int scroll = (size > viewTilesX ? size - viewTilesX : 1);
+            sf::Sprite& sprite = properties.sprite_;
+            clock.restart();
+            for (unsigned int frame = 0; frame < frames; frame++)
+            {
+                unsigned int left = frame % scroll;
+                target.setView(GetView(left));
+                target.clear();
+                for (unsigned int x = left; x <= left + viewTilesX && x < size; x++)
+                {
+                    for (unsigned int y = 0; y <= viewTilesY && y < size; y++)
+                    {
+                        auto itr = tileMap.find(x * size + y);
+                        if (itr == tileMap.end())
+                            continue;
+
+                        sprite.setPosition(static_cast<float>(x * TILE_SIZE), static_cast<float>(y * TILE_SIZE));
+                        target.draw(sprite);
+                    }
+                }
+                target.display();
+            }
+            sf::Time spriteTime = clock.restart();
+
+            sf::RenderStates states;
+            states.texture = &texture;
+            for (unsigned int frame = 0; frame < frames; frame++)
+            {
+                unsigned int left = frame % scroll;
+                target.setView(GetView(left));
+                target.clear();
+                for (unsigned int x = left / TileGrid::CHUNK_SIZE; x <= (left + viewTilesX) / TileGrid::CHUNK_SIZE; x++)
+                {
+                    for (unsigned int y = 0; y <= viewTilesY / TileGrid::CHUNK_SIZE; y++)
+                    {
+                        const sf::VertexArray* vertices = grid.GetChunkVertices(x, y);
+                        if (vertices)
+                            target.draw(*vertices, states);
+                    }
+                }
+                target.display();
+            }
+            sf::Time chunkTime = clock.restart();
+
+            std::cout << "draw: tile by tile " << spriteTime.asMicroseconds() / frames << " us, chunk by chunk "
+                << chunkTime.asMicroseconds() / frames << " us per frame" << std::endl;
+
+            for (auto& itr : tileMap)
+            {
+                delete itr.second;
+            }
+            return true;
+        }
+
+        /**
+         * \brief Time EntityManager::CheckEntityCollision (grid broad phase, contacts and callbacks) against
+         * the all-pairs loop it replaced, from 100 to maxCount entities at the same density.
+         * Entities jitter between steps, the pairs found by both are printed to check they agree.
+         */
+        static bool RunEntityCollision(unsigned int maxCount)
+        {
+            const unsigned int counts[] = {100, 200, 500, 1000, 2000, 5000, 10000, 20000};
+            const unsigned int steps = 10;
+            const float boxSize = 32.0f;
+            const float spacing = 64.0f; // average distance between two entities.
+
+            JobSystem jobSystem(JobSystem::GetDefaultWorkerCount());
+            std::cout << "entity collision: " << jobSystem.GetThreadCount() << " threads" << std::endl;
+            for (unsigned int count : counts)
+            {
+                if (count > maxCount)
+                    break;
+
+                SharedContext context;
+                context.job_system_ = &jobSystem;
+                EntityManager entityMgr(&context, count);
+                entityMgr.RegisterEntity<BenchmarkEntity>(EntityType::PLAYER, count);
+
+                std::mt19937 random(count);
+                const float worldSize = std::sqrt(static_cast<float>(count)) * spacing;
+                std::uniform_real_distribution<float> position(0.0f, worldSize);
+                std::uniform_real_distribution<float> jitter(-4.0f, 4.0f);
+                std::vector<EntityBase*> entities;
+                for (unsigned int i = 0; i < count; i++)
+                {
+                    EntityBase* entity = entityMgr.FindEntityById(entityMgr.AddEntity(EntityType::PLAYER));
+                    if (!entity)
+                        return false;
+
+                    entity->SetCollisionBoxSize(boxSize, boxSize);
+                    entity->SetCurrentPosition(position(random), position(random));
+                    entities.emplace_back(entity);
+                }
+
+                sf::Time gridTime;
+                sf::Time allPairsTime;
+                std::size_t gridPairs = 0;
+                std::size_t allPairs = 0;
+                sf::Clock clock;
+                for (unsigned int step = 0; step < steps; step++)
+                {
+                    for (auto entity : entities)
+                    {
+                        entity->SetCurrentPosition(entity->current_position_.x + jitter(random),
+                                                   entity->current_position_.y + jitter(random));
+                    }
+
+                    clock.restart();
+                    entityMgr.CheckEntityCollision();
+                    gridTime += clock.restart();
+                    gridPairs += entityMgr.contact_cache_.GetCount();
+
+                    // the old detection: every pair of entities, on the same layers as the grid.
+                    for (std::size_t i = 0; i < entities.size(); i++)
+                    {
+                        const EntityBase* first = entities[i];
+                        unsigned int mask = entityMgr.collision_matrix_.GetMask(first->collision_layers_) &
+                            first->collision_mask_;
+                        for (std::size_t j = i + 1; j < entities.size(); j++)
+                        {
+                            const EntityBase* second = entities[j];
+                            if ((mask & second->collision_layers_) != 0 &&
+                                first->collision_bounding_box_.intersects(second->collision_bounding_box_))
+                                ++allPairs;
+                        }
+                    }
+                    allPairsTime += clock.restart();
+                }
+
+                std::cout << count << " entities: grid " << gridTime.asMicroseconds() / steps << " us, all pairs "
+                    << allPairsTime.asMicroseconds() / steps << " us per step, pairs " << gridPairs / steps << " / "
+                    << allPairs / steps << std::endl;
+            }
+            return true;
+        }
+
+        /**
+         * \brief Time tasks run in a loop on this thread, as a job each and with JobSystem::ParallelFor,
+         * tiny tasks for the overhead per job and large ones for the scaling with the threads.
+         */
+        static bool RunJobSystem()
+        {
+            JobSystem jobSystem(JobSystem::GetDefaultWorkerCount());
+            std::cout << "job system: " << jobSystem.GetThreadCount() << " threads" << std::endl;
+            RunJobs(jobSystem, "tiny", 200000, 16);
+            RunJobs(jobSystem, "large", 512, 100000);
+            return true;
+        }
+
+        /**
+         * \brief Run a scene of the game and count the heap allocations of each frame, a steady frame shouldn't
+         * make any (see FrameArena). Entities walk on a map built in code and shoot bullets at each other under a view
+         * scrolling across the map, with a text box on top. The warm-up frames, longer than a bullet takes to cross the
+         * map, fill the pools and caches.
+         * Counting needs the replaced operator new of SFMLTutorial.cpp (see AllocationCounter).
+         * @return false: if a frame past the warm-up allocated.
+         */
+        static bool CheckFrameAllocations(unsigned int frames)
+        {
+            const unsigned int warmUpFrames = 240;
+            const unsigned int entityCount = 200;
+            const unsigned int shotInterval = 4; // frames between two bullets.
+            const float timeStep = 1 / 60.0f;
+            const sf::Vector2u mapSize(64, 20); // in tiles, wider than the view.
+
+            Window window("Allocation check", sf::Vector2u(VIEW_WIDTH, VIEW_HEIGHT));
+            JobSystem jobSystem(JobSystem::GetDefaultWorkerCount());
+            FrameArena frameArena(1024 * 1024);
+            TextureManager textureMgr;
+            SharedContext context;
+            context.window_ = &window;
+            context.event_manager_ = &window.GetEventManager();
+            context.texture_mgr_ = &textureMgr;
+            context.job_system_ = &jobSystem;
+            context.frame_arena_ = &frameArena;
+
+            EntityManager entityMgr(&context, entityCount); // outlives the map, which purges it.
+            context.entity_mgr_ = &entityMgr;
+            entityMgr.RegisterEntity<BenchmarkEntity>(EntityType::PLAYER, entityCount);
+
+            // a floor, walls on both sides and platforms, tiles of the map outlive it.
+            TileInfo properties(&context);
+            properties.sprite_.setTextureRect(sf::IntRect(0, 0, TILE_SIZE, TILE_SIZE));
+            MapData* data = new MapData(mapSize, 512.0f, sf::Vector2f(0.8f, 0.0f));
+            for (unsigned int x = 0; x < mapSize.x; x++)
+            {
+                for (unsigned int y = 0; y < mapSize.y; y++)
+                {
+                    bool isWall = (x == 0 || x == mapSize.x - 1);
+                    bool isFloor = (y >= mapSize.y - 2);
+                    bool isPlatform = (y == mapSize.y - 6 && x % 8 < 3);
+                    if (isWall || isFloor || isPlatform)
+                        data->tile_grid_.AddTile(x, y, &properties);
+                }
+            }
+            Map map(&context, nullptr); // no state: the map has no next map to switch to.
+            map.CommitMapData(data);
+
+            std::mt19937 random(entityCount);
+            std::uniform_real_distribution<float> position(2.0f * TILE_SIZE, (mapSize.x - 2.0f) * TILE_SIZE);
+            std::vector<EntityBase*> walkers;
+            std::vector<float> directions; // -1: walking left, 1: right.
+            for (unsigned int i = 0; i < entityCount; i++)
+            {
+                EntityBase* entity = entityMgr.FindEntityById(entityMgr.AddEntity(EntityType::PLAYER));
+                if (!entity)
+                    return false;
+
+                entity->SetCollisionBoxSize(20.0f, 28.0f);
+                entity->SetCurrentPosition(position(random), 4.0f * TILE_SIZE);
+                entity->speed_ = sf::Vector2f(600.0f, 0.0f);
+                entity->max_velocity_ = sf::Vector2f(200.0f, 1024.0f);
+                entity->friction_ = sf::Vector2f(0.8f, 0.0f);
+                walkers.emplace_back(entity);
+                directions.emplace_back(i % 2 == 0 ? -1.0f : 1.0f);
+            }
+
+            Textbox textbox(5, 14, 350, sf::Vector2f(16.0f, 16.0f));
+            textbox.Add("Allocation check: " + std::to_string(entityCount) + " entities");
+
+            const float scroll = mapSize.x * TILE_SIZE - static_cast<float>(VIEW_WIDTH); // view goes back and forth.
+            unsigned int allocatingFrames = 0;
+            std::size_t maxAllocations = 0;
+            for (unsigned int frame = 0; frame < frames && !window.IsClose(); frame++)
+            {
+                std::size_t before = AllocationCounter::GetCount();
+                window.Update();
+
+                for (std::size_t i = 0; i < walkers.size(); i++)
+                {
+                    EntityBase* walker = walkers[i];
+                    if (walker->activity_ == ActivityTier::ASLEEP) // its acceleration would pile up.
+                        continue;
+
+                    if (walker->is_colliding_on_x_)
+                        directions[i] = -directions[i];
+                    walker->AddAccelerate(directions[i] * walker->speed_.x, 0.0f);
+                }
+
+                if (frame % shotInterval == 0)
+                {
+                    std::size_t shooter = (frame / shotInterval) % walkers.size();
+                    sf::Vector2f muzzle(directions[shooter] * 24.0f, 0.0f);
+                    entityMgr.AddSimpleEntity(walkers[shooter]->current_position_ + muzzle,
+                                              sf::Vector2f(directions[shooter] * 600.0f, 0.0f), sf::Vector2f(8, 8),
+                                              sf::IntRect(0, 0, 8, 8), 0.0f,
+                                              GetLayerBit(CollisionLayer::ENEMY_ATTACK));
+                }
+
+                map.Update(timeStep);
+                entityMgr.Update(timeStep);
+
+                float left = static_cast<float>(frame % (2 * static_cast<unsigned int>(scroll)));
+                left = (left > scroll ? 2 * scroll - left : left);
+                window.GetRenderWindow().setView(sf::View(sf::FloatRect(left, 0.0f, VIEW_WIDTH, VIEW_HEIGHT)));
+
+                window.ClearBeforeDraw();
+                map.Draw();
+                entityMgr.Draw();
+                window.GetRenderWindow().setView(window.GetRenderWindow().getDefaultView());
+                textbox.Render(window.GetRenderWindow());
+                window.DisplayAfterDraw();
+                frameArena.Reset();
+
+                std::size_t allocations = AllocationCounter::GetCount() - before;
+                if (frame < warmUpFrames || allocations == 0)
+                    continue;
+
+                std::cout << "frame " << frame << ": " << allocations << " allocations" << std::endl;
+                ++allocatingFrames;
+                maxAllocations = std::max(maxAllocations, allocations);
+            }
+
+            std::cout << "frames allocating after the warm-up: " << allocatingFrames << ", at most " << maxAllocations
+                << " allocations" << std::endl;
+            return allocatingFrames == 0;
+        }
+
+    private:
+        static constexpr unsigned int JOBS_PER_BATCH = JobSystem::MAX_JOBS_PER_THREAD / 2; // none is recycled early.
+
+        /**
+         * @param taskSize: iterations of a task.
+         */
+        static void RunJobs(JobSystem& jobSystem, const char* name, unsigned int taskCount, unsigned int taskSize)
+        {
+            std::vector<float> results(taskCount);
+            auto task = [&results, taskSize](std::size_t i)
+            {
+                float value = 0.0f;
+                for (unsigned int j = 0; j < taskSize; j++)
+                {
+                    value += std::sqrt(static_cast<float>(i + j));
+                }
+                results[i] = value;
+            };
+
+            sf::Clock clock;
+            for (std::size_t i = 0; i < taskCount; i++)
+            {
+                task(i);
+            }
+            sf::Time serialTime = clock.restart();
+
+            // a job per task, children of a root per batch: a thread may only have so many unfinished jobs.
+            for (unsigned int begin = 0; begin < taskCount; begin += JOBS_PER_BATCH)
+            {
+                Job* root = jobSystem.CreateJob([]
+                {
+                });
+                for (unsigned int i = begin; i < taskCount && i < begin + JOBS_PER_BATCH; i++)
+                {
+                    jobSystem.Run(jobSystem.CreateChildJob(root, [&task, i]
+                    {
+                        task(i);
+                    }));
+                }
+                jobSystem.Run(root);
+                jobSystem.Wait(root);
+            }
+            sf::Time jobTime = clock.restart();
+
+            jobSystem.ParallelFor(taskCount, 1, [&task](std::size_t begin, std::size_t end, unsigned int)
+            {
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    task(i);
+                }
+            });
+            sf::Time parallelForTime = clock.restart();
+
+            std::cout << taskCount << " " << name << " tasks: loop " << serialTime.asMicroseconds() << " us, jobs "
+                << jobTime.asMicroseconds() << " us, parallel for " << parallelForTime.asMicroseconds() << " us ("
+                << results[taskCount - 1] << ")" << std::endl;
+        }
+
+        static constexpr unsigned int VIEW_WIDTH = 800; // in pixels, the size of the game window.
+        static constexpr unsigned int VIEW_HEIGHT = 600;
+
+        /**
+         * \brief Get the view space of a window scrolled to a column of tiles.
+         */
+        static sf::View GetView(unsigned int left)
+        {
+            return sf::View(sf::FloatRect(static_cast<float>(left * TILE_SIZE), 0.0f, VIEW_WIDTH, VIEW_HEIGHT));
+        }
+    };
+}
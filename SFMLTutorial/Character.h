@@ -15,6 +15,7 @@ namespace SFMLTutorial
                                               jump_velocity_(250.0f), hit_points_(5)
         {
             name_ = "Character";
+            SetContinuousCollision(true); // falls get fast enough to go through one tile thick platforms.
         }
 
         virtual ~Character()
@@ -79,6 +80,11 @@ namespace SFMLTutorial
         {
         }
 
+        const sf::FloatRect* GetAttackBox() const override
+        {
+            return (state_ == EntityState::ATTACKING ? &attack_box_ : nullptr);
+        }
+
         void Animate()
         {
         }
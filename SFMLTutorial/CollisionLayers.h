@@ -0,0 +1,79 @@
+#pragma once
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Layers a collision box can be on, a box may be on several (bits of GetLayerBit).
+     */
+    enum class CollisionLayer
+    {
+        PLAYER = 0, // bodies.
+        ENEMY,
+        PICKUP,
+        PLAYER_ATTACK, // attack boxes, hit the hurt boxes of the other side.
+        ENEMY_ATTACK,
+        PLAYER_HURT, // hurt boxes, where a character can be hit.
+        ENEMY_HURT,
+        LAYER_COUNT
+    };
+
+    constexpr unsigned int ALL_COLLISION_LAYERS = 0xFFFFFFFF;
+
+    inline unsigned int GetLayerBit(CollisionLayer layer)
+    {
+        return 1u << static_cast<unsigned int>(layer);
+    }
+
+    /**
+     * \brief Which layers interact with which, boxes on layers which don't interact are never tested.
+     * Interactions are symmetric, none by default.
+     */
+    class CollisionMatrix
+    {
+    public:
+        static constexpr unsigned int MAX_LAYERS = 32;
+
+        CollisionMatrix() : masks_()
+        {
+        }
+
+        void SetInteraction(CollisionLayer first, CollisionLayer second, bool isInteracting)
+        {
+            unsigned int firstIndex = static_cast<unsigned int>(first);
+            unsigned int secondIndex = static_cast<unsigned int>(second);
+            if (isInteracting)
+            {
+                masks_[firstIndex] |= 1u << secondIndex;
+                masks_[secondIndex] |= 1u << firstIndex;
+            }
+            else
+            {
+                masks_[firstIndex] &= ~(1u << secondIndex);
+                masks_[secondIndex] &= ~(1u << firstIndex);
+            }
+        }
+
+        bool IsInteracting(CollisionLayer first, CollisionLayer second) const
+        {
+            return (masks_[static_cast<unsigned int>(first)] & GetLayerBit(second)) != 0;
+        }
+
+        /**
+         * \brief Get the layers interacting with at least one of some layers.
+         * @param layers: bits of GetLayerBit.
+         */
+        unsigned int GetMask(unsigned int layers) const
+        {
+            unsigned int mask = 0;
+            for (unsigned int i = 0; layers != 0; i++, layers >>= 1)
+            {
+                if (layers & 1)
+                    mask |= masks_[i];
+            }
+            return mask;
+        }
+
+    private:
+        unsigned int masks_[MAX_LAYERS]; // layer index -> bits of the layers it interacts with.
+    };
+}
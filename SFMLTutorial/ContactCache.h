@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+namespace SFMLTutorial
+{
+    enum class ContactEvent
+    {
+        ENTER, // the pair overlaps since this step.
+        STAY, // the pair overlapped at the previous step too.
+        EXIT // the pair doesn't overlap any more.
+    };
+
+    /**
+     * \brief Pairs of ids (e.g. entities) overlapping at the previous step, compared to the pairs of the current one
+     * to tell contacts starting, going on and ending apart. Pairs are kept sorted, so a step costs a sort
+     * and a merge, and the events always come in the same order.
+     */
+    class ContactCache
+    {
+    public:
+        /**
+         * \brief Add a pair overlapping at the current step, in any order, once per step.
+         */
+        void Add(unsigned int first, unsigned int second)
+        {
+            current_.emplace_back(MakeKey(first, second));
+        }
+
+        /**
+         * \brief Add a pair whose order matters (e.g. attacker and victim), once per step.
+         * Don't mix with Add in the same cache: (a, b) and (b, a) are different pairs here.
+         */
+        void AddDirected(unsigned int first, unsigned int second)
+        {
+            current_.emplace_back((static_cast<std::uint64_t>(first) << 32) | second);
+        }
+
+        /**
+         * \brief Carry pairs of the previous step over to the current one without testing them again
+         * (e.g. both entities are asleep), they go on as STAY. A kept pair mustn't be added again at the same step.
+         * @param isKept: bool(unsigned int first, unsigned int second), in the order given to Dispatch.
+         */
+        template <typename Predicate>
+        void KeepPrevious(Predicate isKept)
+        {
+            for (auto key : previous_)
+            {
+                if (isKept(static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key & 0xFFFFFFFF)))
+                    current_.emplace_back(key);
+            }
+        }
+
+        /**
+         * \brief Compare the pairs of the current step to the previous one, then start a new step.
+         * @param function: void(ContactEvent event, unsigned int first, unsigned int second), first < second
+         * (in the order given for AddDirected), called in order of the pairs.
+         */
+        template <typename Function>
+        void Dispatch(Function function)
+        {
+            std::sort(current_.begin(), current_.end());
+
+            auto currentItr = current_.begin();
+            auto previousItr = previous_.begin();
+            while (currentItr != current_.end() || previousItr != previous_.end())
+            {
+                if (previousItr == previous_.end() || (currentItr != current_.end() && *currentItr < *previousItr))
+                {
+                    Call(function, ContactEvent::ENTER, *currentItr);
+                    ++currentItr;
+                }
+                else if (currentItr == current_.end() || *previousItr < *currentItr)
+                {
+                    Call(function, ContactEvent::EXIT, *previousItr);
+                    ++previousItr;
+                }
+                else
+                {
+                    Call(function, ContactEvent::STAY, *currentItr);
+                    ++currentItr;
+                    ++previousItr;
+                }
+            }
+
+            previous_.swap(current_);
+            current_.clear();
+        }
+
+        /**
+         * \brief Forget every contact without event (e.g. every entity is removed).
+         */
+        void Clear()
+        {
+            current_.clear();
+            previous_.clear();
+        }
+
+        /**
+         * \brief Get number of pairs overlapping at the previous step.
+         */
+        std::size_t GetCount() const
+        {
+            return previous_.size();
+        }
+
+    private:
+        std::vector<std::uint64_t> current_; // pairs added since the last dispatch.
+        std::vector<std::uint64_t> previous_; // pairs of the last dispatch, sorted.
+
+        /**
+         * \brief Get the key of a pair, the lower id in the high bits.
+         */
+        static std::uint64_t MakeKey(unsigned int first, unsigned int second)
+        {
+            if (second < first)
+                std::swap(first, second);
+            return (static_cast<std::uint64_t>(first) << 32) | second;
+        }
+
+        template <typename Function>
+        static void Call(Function& function, ContactEvent event, std::uint64_t key)
+        {
+            function(event, static_cast<unsigned int>(key >> 32), static_cast<unsigned int>(key & 0xFFFFFFFF));
+        }
+    };
+}
@@ -5,6 +5,11 @@
 #include <vector>
 #include <cstdlib>
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include "FrameArena.h"
+#include "ContactCache.h"
+#include "CollisionLayers.h"
 #include "EntityManager.h" // incomplete class???
 #include "SharedContext.h" // incomplete class???
 #include "Map.h" // incomplete class???
@@ -16,7 +21,8 @@ namespace SFMLTutorial
     {
         BASE, // abstract class
         ENEMY,
-        PLAYER
+        PLAYER,
+        PICKUP
     };
     // @formatter:on
 
@@ -33,6 +39,16 @@ namespace SFMLTutorial
         DYING
     };
 
+    /**
+     * \brief How often an entity is updated, from its distance to the view space (see EntityManager::UpdateActivity).
+     */
+    enum class ActivityTier
+    {
+        ACTIVE, // near the view space, every step.
+        REDUCED, // around it, every few steps with the time accumulated in between.
+        ASLEEP // farther, not updated until woken up.
+    };
+
     class EntityManager; // forward declaration
     struct TileInfo;
 
@@ -67,15 +83,19 @@ namespace SFMLTutorial
     class EntityBase
     {
     private:
-        typedef std::vector<CollisionElement> Collisions;
+        typedef FrameVector<CollisionElement> Collisions; // only live during a move.
 
         friend class EntityManager; // EntityManager could use private and protected method of EntityBase
+        friend class Benchmarks; // compares the collision detection of EntityManager with the old one.
 
     public:
-        EntityBase(EntityManager* entityMgr) : name_("BaseEntity"), type_(EntityType::BASE), id_(0),
+        EntityBase(EntityManager* entityMgr) : name_("BaseEntity"), type_(EntityType::BASE), id_(0), proxy_id_(-1),
                                                reference_tile_(nullptr), state_(EntityState::IDLE),
                                                is_colliding_on_x_(false), is_colliding_on_y_(false),
-                                               entity_mgr_(entityMgr)
+                                               is_continuous_collision_(false), is_on_warp_(false),
+                                               collision_layers_(0), collision_mask_(ALL_COLLISION_LAYERS),
+                                               attack_layers_(0), activity_(ActivityTier::ASLEEP), activity_index_(-1),
+                                               activity_time_(0.0f), awake_time_(0.0f), entity_mgr_(entityMgr)
         {
         }
 
@@ -85,22 +105,62 @@ namespace SFMLTutorial
 
         void SetCurrentPosition(const float& x, const float& y)
         {
-            current_position_ = sf::Vector2f(x, y);
-            UpdateBoundingBoxPosition();
+            SetCurrentPosition(sf::Vector2f(x, y));
         }
 
+        /**
+         * \brief Place the entity, it isn't interpolated from where it was (see GetRenderPosition).
+         */
         void SetCurrentPosition(const sf::Vector2f& position)
         {
             current_position_ = position;
+            previous_position_ = position;
             UpdateBoundingBoxPosition();
         }
 
+        /**
+         * \brief Position to draw the entity at, in between its previous and current simulation steps.
+         */
+        sf::Vector2f GetRenderPosition() const
+        {
+            float interpolation = entity_mgr_->GetContext()->interpolation_;
+            return previous_position_ + (current_position_ - previous_position_) * interpolation;
+        }
+
         void SetCollisionBoxSize(const float& x, const float& y)
         {
             collision_box_size_ = sf::Vector2f(x, y);
             UpdateBoundingBoxPosition();
         }
 
+        /**
+         * \brief Sweep the bounding box against the tiles instead of resolving overlaps after moving.
+         * Meant for fast entities (projectiles, dashing characters) which would go through thin platforms.
+         */
+        void SetContinuousCollision(bool isContinuous)
+        {
+            is_continuous_collision_ = isContinuous;
+        }
+
+        /**
+         * \brief Put the bounding box on collision layers, instead of the ones of the entity type.
+         * @param layers: bits of GetLayerBit.
+         * @param mask: layers the entity may collide with, narrowed by the collision matrix of the entity manager.
+         */
+        void SetCollisionLayers(unsigned int layers, unsigned int mask = ALL_COLLISION_LAYERS)
+        {
+            collision_layers_ = layers;
+            collision_mask_ = mask;
+        }
+
+        /**
+         * \brief Put the attack box (see GetAttackBox) on collision layers, instead of the ones of the entity type.
+         */
+        void SetAttackLayers(unsigned int layers)
+        {
+            attack_layers_ = layers;
+        }
+
         void SetState(const EntityState& state)
         {
             if (state_ == EntityState::DYING) // is dying?
@@ -208,6 +268,11 @@ namespace SFMLTutorial
             }
         }
 
+        /**
+         * \brief Apply forces and friction to the velocity, the move is done by MoveAndCollide.
+         * Runs on worker threads along other entities (see EntityManager::Update): an override
+         * may only change the entity itself and read the map, anything else goes to HandleCollisionWithOtherEntity.
+         */
         virtual void Update(float deltaTime)
         {
             // add gravity and velocity by acceleration.
@@ -239,13 +304,28 @@ namespace SFMLTutorial
             ApplyFriction(frictionX, frictionY);
 
             // the change in position.
-            sf::Vector2f deltaPosition = velocity_ * deltaTime;
-            Move(deltaPosition.x, deltaPosition.y);
+            delta_position_ = velocity_ * deltaTime;
+        }
+
+        /**
+         * \brief Move by the change in position computed by Update, then resolve the collisions with the tiles.
+         * Only changes the entity itself, so it runs on worker threads too.
+         */
+        void MoveAndCollide()
+        {
+            sf::Vector2f deltaPosition = delta_position_;
+            delta_position_ = sf::Vector2f();
 
             is_colliding_on_x_ = false;
             is_colliding_on_y_ = false;
-            CheckCollisions();
-            ResolveCollisions();
+            if (is_continuous_collision_)
+            {
+                MoveAndSweep(deltaPosition);
+                return;
+            }
+
+            Move(deltaPosition.x, deltaPosition.y);
+            CollideWithTiles();
         }
 
         virtual void Draw(sf::RenderWindow* window) = 0;
@@ -254,9 +334,12 @@ namespace SFMLTutorial
         std::string name_;
         EntityType type_;
         unsigned int id_; // entity id in the entity manager.
+        int proxy_id_; // leaf in the entity manager's tree, -1: not in the tree (e.g. parked).
         sf::Vector2f current_position_;
         sf::Vector2f old_position_; // position before entity moved.
+        sf::Vector2f previous_position_; // position at the start of the simulation step, for rendering.
         sf::Vector2f velocity_;
+        sf::Vector2f delta_position_; // move of the step, set by Update and done by MoveAndCollide.
         sf::Vector2f max_velocity_;
         sf::Vector2f speed_;
         sf::Vector2f acceleration_;
@@ -267,7 +350,15 @@ namespace SFMLTutorial
         EntityState state_;
         bool is_colliding_on_x_;
         bool is_colliding_on_y_;
-        Collisions collisions_;
+        bool is_continuous_collision_; // sweep against the tiles while moving? (see MoveAndSweep)
+        bool is_on_warp_; // has the player touched a warp tile? the entity manager loads the next map after the step.
+        unsigned int collision_layers_; // of the bounding box, 0: the ones of the type (see EntityManager::AddEntity).
+        unsigned int collision_mask_;
+        unsigned int attack_layers_; // of the attack box.
+        ActivityTier activity_;
+        int activity_index_; // in the awake entities of the entity manager, -1: asleep or parked.
+        float activity_time_; // time to update the entity by, accumulated while its updates are skipped.
+        float awake_time_; // time since the entity was woken up, it doesn't fall asleep right away.
         EntityManager* entity_mgr_;
 
         /**
@@ -282,10 +373,21 @@ namespace SFMLTutorial
                                                     collision_box_size_.y);
         }
 
+        /**
+         * \brief Find the tiles the entity overlaps and push it out of them.
+         */
+        void CollideWithTiles()
+        {
+            // transient, in the frame arena rather than on the heap.
+            Collisions collisions(FrameAllocator<CollisionElement>(entity_mgr_->GetContext()->frame_arena_));
+            CheckCollisions(collisions);
+            ResolveCollisions(collisions);
+        }
+
         /**
          * \brief Dectect collisions
          */
-        void CheckCollisions()
+        void CheckCollisions(Collisions& collisions)
         {
             // get tile size
             Map* gameMap = entity_mgr_->GetContext()->game_map_;
@@ -297,67 +399,193 @@ namespace SFMLTutorial
             int fromY = floor(collision_bounding_box_.top / tileSize);
             int toY = floor((collision_bounding_box_.top + collision_bounding_box_.height) / tileSize);
 
-            for (int x = fromX; x <= toX; x++)
+            // skip the tile lookups when no tile is overlapped.
+            if (!gameMap->AnyTile(TileMask::SOLID, fromX, fromY, toX, toY))
+                return;
+
+            // merged tiles, a floor is a few boxes instead of a box per tile.
+            gameMap->ForEachTileCollider(fromX, fromY, toX, toY, [&](const TileCollider& collider)
+            {
+                // get collision information
+                sf::FloatRect tileBounds(collider.area_.left * tileSize, collider.area_.top * tileSize,
+                                         collider.area_.width * tileSize, collider.area_.height * tileSize);
+                // collision bounds of tile
+                sf::FloatRect intersection;
+                collision_bounding_box_.intersects(tileBounds, intersection);
+                float area = intersection.width * intersection.height;
+
+                CollisionElement element(area, collider.properties_, tileBounds);
+                collisions.emplace_back(element);
+
+                if (collider.is_warp_ && type_ == EntityType::PLAYER)
+                    is_on_warp_ = true;
+            });
+        }
+
+        /**
+         * \brief Move while sweeping the bounding box against the tiles (continuous collision).
+         * The entity stops at the time of impact and slides along the surface for the rest of the move.
+         */
+        void MoveAndSweep(sf::Vector2f deltaPosition)
+        {
+            Map* gameMap = entity_mgr_->GetContext()->game_map_;
+            const float tileSize = static_cast<float>(gameMap->GetTileSize());
+            const float contactSlop = 0.01f; // overlaps smaller than this (in pixels) count as a contact.
+
+            bool isOverlapping = false; // did the entity start inside a tile? sweeping can't resolve it.
+            for (int step = 0; step < 3 && (deltaPosition.x != 0 || deltaPosition.y != 0); step++) // a slide per axis.
             {
-                for (int y = fromY; y <= toY; y++)
+                // tiles the bounding box could touch during the move.
+                const sf::FloatRect& box = collision_bounding_box_;
+                int fromX = floor(std::min(box.left, box.left + deltaPosition.x) / tileSize);
+                int toX = floor((std::max(box.left, box.left + deltaPosition.x) + box.width) / tileSize);
+                int fromY = floor(std::min(box.top, box.top + deltaPosition.y) / tileSize);
+                int toY = floor((std::max(box.top, box.top + deltaPosition.y) + box.height) / tileSize);
+
+                float impactTime = 1.0f;
+                bool isImpactOnX = false;
+                const TileCollider* impact = nullptr;
+                if (gameMap->AnyTile(TileMask::SOLID, fromX, fromY, toX, toY))
                 {
-                    Tile* tile = gameMap->GetTile(x, y);
-                    if (!tile)
-                        continue;
+                    gameMap->ForEachTileCollider(fromX, fromY, toX, toY, [&](const TileCollider& collider)
+                    {
+                        sf::FloatRect tileBounds(collider.area_.left * tileSize, collider.area_.top * tileSize,
+                                                 collider.area_.width * tileSize, collider.area_.height * tileSize);
+
+                        // times the box enters and leaves the tile on each axis, a fraction of the move.
+                        float entryX;
+                        float exitX;
+                        if (!GetSweepInterval(box.left, box.width, tileBounds.left, tileBounds.width,
+                                              deltaPosition.x, contactSlop, entryX, exitX))
+                            return;
+
+                        float entryY;
+                        float exitY;
+                        if (!GetSweepInterval(box.top, box.height, tileBounds.top, tileBounds.height,
+                                              deltaPosition.y, contactSlop, entryY, exitY))
+                            return;
+
+                        float entry = std::max(entryX, entryY);
+                        float exit = std::min(exitX, exitY);
+                        if (entry < 0.0f)
+                        {
+                            isOverlapping = true;
+                            return;
+                        }
+
+                        if (entry >= exit || entry > impactTime || (entry == impactTime && impact))
+                            return;
+
+                        impactTime = entry;
+                        isImpactOnX = (entryX > entryY);
+                        impact = &collider;
+                    });
+                }
 
-                    // get collision information
-                    sf::FloatRect tileBounds(x * tileSize, y * tileSize, tileSize, tileSize);
-                    // collision bounds of tile
-                    sf::FloatRect intersection;
-                    collision_bounding_box_.intersects(tileBounds, intersection);
-                    float area = intersection.width * intersection.height;
+                Move(deltaPosition.x * impactTime, deltaPosition.y * impactTime);
+                if (!impact)
+                    break;
 
-                    CollisionElement element(area, tile->properties_, tileBounds);
-                    collisions_.emplace_back(element);
+                if (impact->is_warp_ && type_ == EntityType::PLAYER)
+                    is_on_warp_ = true;
 
-                    if (tile->is_warp_ && type_ == EntityType::PLAYER)
-                        gameMap->LoadNextMap();
+                // slide: keep the rest of the move along the surface.
+                deltaPosition *= 1.0f - impactTime;
+                if (isImpactOnX)
+                {
+                    deltaPosition.x = 0;
+                    velocity_.x = 0;
+                    is_colliding_on_x_ = true;
+                }
+                else
+                {
+                    deltaPosition.y = 0;
+                    velocity_.y = 0;
+                    if (!is_colliding_on_y_)
+                        reference_tile_ = impact->properties_;
+                    is_colliding_on_y_ = true;
                 }
             }
+
+            if (isOverlapping)
+            {
+                CollideWithTiles();
+            }
+            else if (!is_colliding_on_y_)
+            {
+                reference_tile_ = nullptr;
+            }
         }
 
-        void ResolveCollisions()
+        /**
+         * \brief Get when a moving segment overlaps a fixed one on one axis, as fractions of the move.
+         * @param position, size: moving segment.
+         * @param tilePosition, tileSize: fixed segment.
+         * @param entry, exit: [-infinity, infinity] when it doesn't move and overlaps.
+         * @return false: if they never overlap.
+         */
+        static bool GetSweepInterval(float position, float size, float tilePosition, float tileSize, float delta,
+                                     float contactSlop, float& entry, float& exit)
         {
-            if (!collisions_.empty())
+            // distances to travel before the segments touch and after they separate.
+            float entryDistance;
+            float exitDistance;
+            if (delta > 0)
             {
-                std::sort(collisions_.begin(), collisions_.end(), SortDescendingCollisionsByArea);
-                // refactor using lambda expression here???
+                entryDistance = tilePosition - (position + size);
+                exitDistance = (tilePosition + tileSize) - position;
+            }
+            else if (delta < 0)
+            {
+                entryDistance = position - (tilePosition + tileSize);
+                exitDistance = (position + size) - tilePosition;
+            }
+            else
+            {
+                // touching isn't overlapping, so the entity can slide along a surface.
+                if (position + size - contactSlop <= tilePosition || tilePosition + tileSize - contactSlop <= position)
+                    return false;
+
+                entry = -std::numeric_limits<float>::infinity();
+                exit = std::numeric_limits<float>::infinity();
+                return true;
+            }
+
+            if (entryDistance < 0 && entryDistance > -contactSlop) // resting against the tile.
+                entryDistance = 0;
+
+            entry = entryDistance / abs(delta);
+            exit = exitDistance / abs(delta);
+            return exit > 0;
+        }
 
-                // get tile size
-                Map* gameMap = entity_mgr_->GetContext()->game_map_;
-                unsigned int tileSize = gameMap->GetTileSize();
+        void ResolveCollisions(Collisions& collisions)
+        {
+            if (!collisions.empty())
+            {
+                std::sort(collisions.begin(), collisions.end(), SortDescendingCollisionsByArea);
+                // refactor using lambda expression here???
 
-                for (auto& collisionItr : collisions_)
+                for (auto& collisionItr : collisions)
                 {
-                    if (!collision_bounding_box_.intersects(collisionItr.tile_bounds_))
+                    sf::FloatRect intersection;
+                    if (!collision_bounding_box_.intersects(collisionItr.tile_bounds_, intersection))
                         continue;
 
-                    // calculate distances from the center of the entity's bounding box to the center of the tile's bounding box
-                    float xDiff = (collision_bounding_box_.left + collision_bounding_box_.width / 2) - (collisionItr
-                                                                                                        .tile_bounds_.
-                                                                                                        left +
-                        collisionItr.tile_bounds_.width / 2);
-                    float yDiff = (collision_bounding_box_.top + collision_bounding_box_.height / 2) - (collisionItr
-                                                                                                        .tile_bounds_.
-                                                                                                        top +
-                        collisionItr.tile_bounds_.height / 2);
-
+                    const sf::FloatRect& tileBounds = collisionItr.tile_bounds_;
                     float resolve = 0.0f;
-                    // which axis the resolution takes place?
-                    if (abs(xDiff) > abs(yDiff))
+                    // which axis the resolution takes place? the one the entity went the least into the tiles,
+                    // the centers can't be compared since merged tiles may be much bigger than the entity.
+                    if (intersection.width < intersection.height)
                     {
                         // which side of tile the entity is on?
+                        float xDiff = (collision_bounding_box_.left + collision_bounding_box_.width / 2) - (tileBounds
+                            .left + tileBounds.width / 2);
                         if (xDiff > 0) // right side?
-                            resolve = collisionItr.tile_bounds_.left + tileSize - collision_bounding_box_.left; // ???
+                            resolve = tileBounds.left + tileBounds.width - collision_bounding_box_.left;
                         else
-                            resolve = -((collision_bounding_box_.left + collision_bounding_box_.width) - collisionItr
-                                                                                                         .tile_bounds_.
-                                                                                                         left); // ???
+                            resolve = -((collision_bounding_box_.left + collision_bounding_box_.width) - tileBounds.
+                                left);
 
                         Move(resolve, 0);
                         velocity_.x = 0;
@@ -365,12 +593,13 @@ namespace SFMLTutorial
                     }
                     else
                     {
+                        float yDiff = (collision_bounding_box_.top + collision_bounding_box_.height / 2) - (tileBounds
+                            .top + tileBounds.height / 2);
                         if (yDiff > 0)
-                            resolve = collisionItr.tile_bounds_.top + tileSize - collision_bounding_box_.top;
+                            resolve = tileBounds.top + tileBounds.height - collision_bounding_box_.top;
                         else
-                            resolve = -((collision_bounding_box_.top + collision_bounding_box_.height) - collisionItr
-                                                                                                         .tile_bounds_.
-                                                                                                         top);
+                            resolve = -((collision_bounding_box_.top + collision_bounding_box_.height) - tileBounds.
+                                top);
 
                         Move(0, resolve);
                         velocity_.y = 0;
@@ -382,7 +611,7 @@ namespace SFMLTutorial
                     }
                 }
 
-                collisions_.clear();
+                collisions.clear();
             }
 
             if (!is_colliding_on_y_)
@@ -390,10 +619,53 @@ namespace SFMLTutorial
         }
 
         /**
-         * \brief Handle the collision.
-         * @param collider: entity that is collided with.
+         * \brief Get the box the entity hits others with, it collides on the attack layers.
+         * @return nullptr: if the entity isn't attacking.
+         */
+        virtual const sf::FloatRect* GetAttackBox() const
+        {
+            return nullptr;
+        }
+
+        /**
+         * \brief Handle the collision, once when a contact starts (see HandleContact) or an attack starts hitting.
+         * @param collider: entity that is collided with, nullptr: hit by a simple entity (e.g. a bullet).
          * @param isAttack: false is a normal collision, true: attack collision.
          */
         virtual void HandleCollisionWithOtherEntity(EntityBase* collider, bool isAttack) = 0;
+
+        /**
+         * \brief Handle a step during which the entity keeps overlapping another one.
+         */
+        virtual void OnContactStay(EntityBase* collider)
+        {
+        }
+
+        /**
+         * \brief Handle the end of a contact with another entity.
+         * @param collider: nullptr if it has been removed.
+         */
+        virtual void OnContactExit(EntityBase* collider)
+        {
+        }
+
+        /**
+         * \brief Pass a contact event to its handler, called by the entity manager after the collision detection.
+         */
+        void HandleContact(ContactEvent event, EntityBase* collider)
+        {
+            switch (event)
+            {
+            case ContactEvent::ENTER:
+                HandleCollisionWithOtherEntity(collider, false);
+                break;
+            case ContactEvent::STAY:
+                OnContactStay(collider);
+                break;
+            case ContactEvent::EXIT:
+                OnContactExit(collider);
+                break;
+            }
+        }
     };
 }
@@ -0,0 +1,363 @@
+#pragma once
+
+#include "pch.h"
+#include "TileMask.h"
+#include "KinematicsKernel.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+namespace SFMLTutorial
+{
+    struct TransformComponent
+    {
+        sf::Vector2f position_; // center of the entity.
+    };
+
+    static_assert(sizeof(TransformComponent) == sizeof(sf::Vector2f), "transforms are integrated as packed positions");
+
+    /**
+     * \brief Kinematics of an entity being added, ComponentStore keeps them in KinematicsArrays.
+     * Simple entities don't follow the rules of EntityBase: a max velocity of 0 means no limit instead of
+     * stopping the entity, and friction is taken as is instead of being scaled by a speed and read from tiles.
+     */
+    struct KinematicsComponent
+    {
+        sf::Vector2f velocity_;
+        sf::Vector2f acceleration_; // cleared after every update.
+        sf::Vector2f max_velocity_; // 0: no limit on this axis.
+        sf::Vector2f friction_; // velocity lost per second.
+        float gravity_scale_ = 0.0f; // 0: not affected by gravity (e.g. bullets).
+    };
+
+    struct CollisionBoxComponent
+    {
+        sf::Vector2f size_;
+        sf::FloatRect bounds_; // in the world, follows the transform.
+        unsigned int layers_ = 0; // bits of GetLayerBit, hits the entities on interacting layers. 0: no entity.
+    };
+
+    struct SpriteComponent
+    {
+        sf::IntRect texture_rect_; // drawn centered on the transform, all sprites share a texture.
+    };
+
+    /**
+     * \brief Dense storage of simple entities (e.g. bullets): one contiguous array per component,
+     * so systems go through them linearly instead of calling a virtual update per heap-allocated entity.
+     * The entity at index i of every array is the same, removals move the last entity into the hole.
+     * An id is a slot and its generation (as EntityHandles), ids of removed entities stay stale when slots are reused.
+     */
+    class ComponentStore
+    {
+    public:
+        static constexpr unsigned int INDEX_BITS = 20; // of the slot in an id, the other bits are its generation.
+        static constexpr unsigned int SLOT_MASK = (1u << INDEX_BITS) - 1;
+        static constexpr unsigned int GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+        static constexpr unsigned int MAX_COUNT = SLOT_MASK; // slot SLOT_MASK is never used.
+        static constexpr unsigned int INVALID_INDEX = 0xFFFFFFFF;
+        static constexpr unsigned int INVALID_ID = 0xFFFFFFFF;
+
+        /**
+         * \brief Add an entity.
+         * @return id of the entity, stays valid until the entity is removed. INVALID_ID: if there are MAX_COUNT.
+         */
+        unsigned int AddEntity(const TransformComponent& transform, const KinematicsComponent& kinematics,
+                               const CollisionBoxComponent& collisionBox, const SpriteComponent& sprite)
+        {
+            unsigned int slot;
+            if (!free_slots_.empty())
+            {
+                slot = free_slots_.back();
+                free_slots_.pop_back();
+            }
+            else
+            {
+                if (indices_.size() >= MAX_COUNT)
+                    return INVALID_ID;
+
+                slot = static_cast<unsigned int>(indices_.size());
+                indices_.emplace_back(INVALID_INDEX);
+                generations_.emplace_back(0);
+            }
+
+            unsigned int id = (generations_[slot] << INDEX_BITS) | slot;
+            indices_[slot] = static_cast<unsigned int>(ids_.size());
+            ids_.emplace_back(id);
+            transforms_.emplace_back(transform);
+            previous_positions_.emplace_back(transform.position_);
+            kinematics_.Add(kinematics.velocity_, kinematics.acceleration_, kinematics.max_velocity_,
+                            kinematics.friction_, kinematics.gravity_scale_);
+            collision_boxes_.emplace_back(collisionBox);
+            sprites_.emplace_back(sprite);
+            return id;
+        }
+
+        /**
+         * @return false: if the id is stale (e.g. removed twice), no entity is removed.
+         */
+        bool RemoveEntity(unsigned int id)
+        {
+            if (!HasEntity(id))
+                return false;
+
+            // move the last entity into the hole.
+            unsigned int slot = id & SLOT_MASK;
+            unsigned int index = indices_[slot];
+            unsigned int last = static_cast<unsigned int>(ids_.size()) - 1;
+            if (index != last)
+            {
+                ids_[index] = ids_[last];
+                transforms_[index] = transforms_[last];
+                previous_positions_[index] = previous_positions_[last];
+                kinematics_.Copy(index, last);
+                collision_boxes_[index] = collision_boxes_[last];
+                sprites_[index] = sprites_[last];
+                indices_[ids_[index] & SLOT_MASK] = index;
+            }
+
+            ids_.pop_back();
+            transforms_.pop_back();
+            previous_positions_.pop_back();
+            kinematics_.RemoveLast();
+            collision_boxes_.pop_back();
+            sprites_.pop_back();
+            indices_[slot] = INVALID_INDEX;
+            generations_[slot] = (generations_[slot] + 1) & GENERATION_MASK;
+            free_slots_.emplace_back(slot);
+            return true;
+        }
+
+        bool HasEntity(unsigned int id) const
+        {
+            unsigned int slot = id & SLOT_MASK;
+            return (slot < indices_.size() && indices_[slot] != INVALID_INDEX &&
+                generations_[slot] == (id >> INDEX_BITS));
+        }
+
+        /**
+         * \brief Get index of an entity in the component arrays, changes when an entity is removed.
+         * @return INVALID_INDEX: if the id is stale.
+         */
+        unsigned int GetIndex(unsigned int id) const
+        {
+            return (HasEntity(id) ? indices_[id & SLOT_MASK] : INVALID_INDEX);
+        }
+
+        void Clear()
+        {
+            ids_.clear();
+            transforms_.clear();
+            previous_positions_.clear();
+            kinematics_.Clear();
+            collision_boxes_.clear();
+            sprites_.clear();
+
+            // keep the generations, ids given before must stay stale.
+            free_slots_.clear();
+            for (unsigned int i = 0; i < indices_.size(); i++)
+            {
+                if (indices_[i] != INVALID_INDEX)
+                {
+                    indices_[i] = INVALID_INDEX;
+                    generations_[i] = (generations_[i] + 1) & GENERATION_MASK;
+                }
+                free_slots_.emplace_back(i);
+            }
+        }
+
+        std::size_t GetCount() const
+        {
+            return ids_.size();
+        }
+
+        const std::vector<unsigned int>& GetIds() const
+        {
+            return ids_;
+        }
+
+        std::vector<TransformComponent>& GetTransforms()
+        {
+            return transforms_;
+        }
+
+        const std::vector<sf::Vector2f>& GetPreviousPositions() const
+        {
+            return previous_positions_;
+        }
+
+        /**
+         * \brief Remember the positions before an update, sprites are drawn in between (see BuildSpriteVertices).
+         */
+        void SavePreviousPositions()
+        {
+            for (std::size_t i = 0; i < transforms_.size(); i++)
+            {
+                previous_positions_[i] = transforms_[i].position_;
+            }
+        }
+
+        /**
+         * \brief Kinematics are stored one array per field, for KinematicsKernel.
+         */
+        KinematicsArrays& GetKinematics()
+        {
+            return kinematics_;
+        }
+
+        std::vector<CollisionBoxComponent>& GetCollisionBoxes()
+        {
+            return collision_boxes_;
+        }
+
+        std::vector<SpriteComponent>& GetSprites()
+        {
+            return sprites_;
+        }
+
+    private:
+        std::vector<unsigned int> ids_; // index -> id.
+        std::vector<TransformComponent> transforms_;
+        std::vector<sf::Vector2f> previous_positions_; // positions before the last update, for rendering and sweeping.
+        KinematicsArrays kinematics_;
+        std::vector<CollisionBoxComponent> collision_boxes_;
+        std::vector<SpriteComponent> sprites_;
+
+        std::vector<unsigned int> indices_; // slot -> index, INVALID_INDEX: the slot is free.
+        std::vector<unsigned int> generations_; // slot -> generation, incremented when its entity is removed.
+        std::vector<unsigned int> free_slots_;
+    };
+
+    /**
+     * \brief Systems updating the components of a ComponentStore, one pass over one or two arrays each.
+     */
+    class EntitySystems
+    {
+    public:
+        /**
+         * \brief Apply gravity, acceleration and friction to the velocities, then move the transforms.
+         * Several entities at a time, see KinematicsKernel.
+         */
+        static void UpdateKinematics(ComponentStore& store, float gravity, float deltaTime)
+        {
+            if (store.GetCount() == 0)
+                return;
+
+            KinematicsKernel::Integrate(store.GetKinematics(), &store.GetTransforms()[0].position_, gravity,
+                                        deltaTime);
+        }
+
+        /**
+         * \brief Move the collision boxes to their transforms.
+         */
+        static void UpdateCollisionBoxes(ComponentStore& store)
+        {
+            const std::vector<TransformComponent>& transforms = store.GetTransforms();
+            std::vector<CollisionBoxComponent>& boxes = store.GetCollisionBoxes();
+            for (std::size_t i = 0; i < boxes.size(); i++)
+            {
+                boxes[i].bounds_ = sf::FloatRect(transforms[i].position_.x - boxes[i].size_.x / 2,
+                                                 transforms[i].position_.y - boxes[i].size_.y / 2, boxes[i].size_.x,
+                                                 boxes[i].size_.y);
+            }
+        }
+
+        /**
+         * \brief Find the entities which hit a tile since the last update, or are out of the map.
+         * The boxes are swept from their previous positions a tile at most at a time, so fast entities
+         * (bullets) don't go through thin tiles.
+         * @param map: Map, a template parameter so the components don't depend on the map.
+         * @param hits: ids of the entities found.
+         */
+        template <class TileMap>
+        static void FindTileHits(ComponentStore& store, const TileMap& map, std::vector<unsigned int>& hits)
+        {
+            const float tileSize = static_cast<float>(map.GetTileSize());
+            const sf::Vector2u mapSize = map.GetMapSize();
+            const float mapWidth = mapSize.x * tileSize;
+            const float mapHeight = mapSize.y * tileSize;
+
+            const std::vector<unsigned int>& ids = store.GetIds();
+            const std::vector<TransformComponent>& transforms = store.GetTransforms();
+            const std::vector<sf::Vector2f>& previousPositions = store.GetPreviousPositions();
+            const std::vector<CollisionBoxComponent>& boxes = store.GetCollisionBoxes();
+            for (std::size_t i = 0; i < boxes.size(); i++)
+            {
+                const sf::FloatRect& bounds = boxes[i].bounds_;
+                if (bounds.left + bounds.width < 0 || bounds.top + bounds.height < 0 || bounds.left > mapWidth ||
+                    bounds.top > mapHeight)
+                {
+                    hits.emplace_back(ids[i]);
+                    continue;
+                }
+
+                // steps of a tile at most on each axis, so no tile fits between two of them.
+                const sf::Vector2f deltaPosition = transforms[i].position_ - previousPositions[i];
+                const float distance = std::max(abs(deltaPosition.x), abs(deltaPosition.y));
+                const int steps = std::max(1, static_cast<int>(ceil(distance / tileSize)));
+                for (int step = steps - 1; step >= 0; step--)
+                {
+                    const sf::Vector2f offset = deltaPosition * (static_cast<float>(step) / steps);
+                    const float left = bounds.left - offset.x;
+                    const float top = bounds.top - offset.y;
+                    int fromX = static_cast<int>(floor(left / tileSize));
+                    int fromY = static_cast<int>(floor(top / tileSize));
+                    int toX = static_cast<int>(floor((left + bounds.width) / tileSize));
+                    int toY = static_cast<int>(floor((top + bounds.height) / tileSize));
+                    if (map.AnyTile(TileMask::SOLID, fromX, fromY, toX, toY))
+                    {
+                        hits.emplace_back(ids[i]);
+                        break;
+                    }
+                }
+            }
+        }
+
+        /**
+         * \brief Build the quads of the sprites within an area, to draw them with a single draw call.
+         * @param interpolation: [0, 1] from the positions before the last update to the current ones.
+         * @return number of sprites.
+         */
+        static std::size_t BuildSpriteVertices(ComponentStore& store, const sf::FloatRect& area, float interpolation,
+                                               sf::VertexArray& vertices)
+        {
+            const std::vector<TransformComponent>& transforms = store.GetTransforms();
+            const std::vector<sf::Vector2f>& previousPositions = store.GetPreviousPositions();
+            const std::vector<SpriteComponent>& sprites = store.GetSprites();
+
+            vertices.setPrimitiveType(sf::Quads);
+            vertices.resize(sprites.size() * 4);
+
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < sprites.size(); i++)
+            {
+                const sf::IntRect& texRect = sprites[i].texture_rect_;
+                sf::Vector2f position = previousPositions[i] + (transforms[i].position_ - previousPositions[i]) *
+                    interpolation;
+                float left = position.x - texRect.width / 2.0f;
+                float top = position.y - texRect.height / 2.0f;
+                if (!area.intersects(sf::FloatRect(left, top, static_cast<float>(texRect.width),
+                                                   static_cast<float>(texRect.height))))
+                    continue;
+
+                sf::Vertex* quad = &vertices[count * 4];
+                quad[0].position = sf::Vector2f(left, top);
+                quad[1].position = sf::Vector2f(left + texRect.width, top);
+                quad[2].position = sf::Vector2f(left + texRect.width, top + texRect.height);
+                quad[3].position = sf::Vector2f(left, top + texRect.height);
+
+                quad[0].texCoords = sf::Vector2f(static_cast<float>(texRect.left), static_cast<float>(texRect.top));
+                quad[1].texCoords = sf::Vector2f(static_cast<float>(texRect.left + texRect.width),
+                                                 static_cast<float>(texRect.top));
+                quad[2].texCoords = sf::Vector2f(static_cast<float>(texRect.left + texRect.width),
+                                                 static_cast<float>(texRect.top + texRect.height));
+                quad[3].texCoords = sf::Vector2f(static_cast<float>(texRect.left),
+                                                 static_cast<float>(texRect.top + texRect.height));
+                ++count;
+            }
+
+            vertices.resize(count * 4);
+            return count;
+        }
+    };
+}
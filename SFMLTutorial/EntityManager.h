@@ -4,20 +4,35 @@
 #include <functional>
 #include <vector>
 #include <iterator>
+#include <algorithm>
+#include "SpatialGrid.h"
+#include "AABBTree.h"
+#include "EntityComponents.h"
+#include "EntityPool.h"
+#include "JobSystem.h"
+#include "ContactCache.h"
+#include "CollisionLayers.h"
 
 namespace SFMLTutorial
 {
     class EntityBase; // ???
     enum class EntityType;
     struct SharedContext; // forward declaration
+    class Map;
 
     class EntityManager
     {
     public:
-        EntityManager(SharedContext* context, unsigned int maxEntities) : context_(context), id_counter_(0),
-                                                                          max_entities_(maxEntities)
+        EntityManager(SharedContext* context, unsigned int maxEntities) : context_(context),
+                                                                          max_entities_(maxEntities),
+                                                                          handles_(maxEntities),
+                                                                          broad_phase_(BROAD_PHASE_CELL_SIZE),
+                                                                          entity_tree_(ENTITY_TREE_MARGIN),
+                                                                          simple_entity_texture_(nullptr),
+                                                                          step_count_(0)
         {
             LoadEnemyTypesFromFile("EnemyList.list");
+            SetDefaultCollisionMatrix();
             //RegisterEntity<Player>(EntityType::PLAYER);
             //RegisterEntity<Enemy>(EntityType::ENEMY);
         }
@@ -25,24 +40,45 @@ namespace SFMLTutorial
         ~EntityManager()
         {
             Purge();
+            SetSimpleEntityTexture("");
+
+            for (auto& itr : entity_factory_)
+            {
+                delete itr.second;
+            }
         }
 
         /**
-         * \brief 
-         * @return -1: If failed, id counter of entity if success.
+         * \brief Create an entity in the pool of its type.
+         * @return EntityHandles::INVALID_HANDLE: If failed, handle of the entity (its id) if success.
          */
-        int AddEntity(const EntityType& type, const std::string& name = "")
+        unsigned int AddEntity(const EntityType& type, const std::string& name = "")
         {
             auto itr = entity_factory_.find(type);
-            if (itr == entity_factory_.end())
-                return -1;
+            if (itr == entity_factory_.end() || handles_.GetCount() >= max_entities_)
+                return EntityHandles::INVALID_HANDLE;
+
+            EntityBase* entity = itr->second->Create(); // new T(this) in the pool.
+            if (!entity)
+                return EntityHandles::INVALID_HANDLE;
+
+            unsigned int handle = handles_.Add(entity, itr->second);
+            if (handle == EntityHandles::INVALID_HANDLE)
+            {
+                itr->second->Destroy(entity);
+                return EntityHandles::INVALID_HANDLE;
+            }
 
-            EntityBase* entity = (itr->second)(); // call std::function(): new T(this)
-            entity->id_ = id_counter_;
+            entity->id_ = handle;
             if (!name.empty())
                 entity->name_ = name;
+            if (entity->collision_layers_ == 0)
+                entity->collision_layers_ = GetDefaultCollisionLayers(type);
+            if (entity->attack_layers_ == 0)
+                entity->attack_layers_ = GetDefaultAttackLayers(type);
 
-            entities_.emplace(id_counter_, entity);
+            entity->proxy_id_ = entity_tree_.CreateProxy(entity->collision_bounding_box_, entity);
+            WakeEntity(entity, ActivityTier::ACTIVE);
 
             if (type == EntityType::ENEMY)
             {
@@ -55,24 +91,122 @@ namespace SFMLTutorial
                 }
             }
 
-            ++id_counter_;
-            return (id_counter_ - 1);
+            return handle;
+        }
+
+        /**
+         * \brief Add a simple entity (e.g. a bullet) to the component store, see ComponentStore.
+         * It moves in a straight line (or falls if gravityScale isn't 0) and is removed when it hits a tile,
+         * or an entity on a layer interacting with its own (see CheckEntityCollision).
+         * @param textureRect: sprite in the texture set by SetSimpleEntityTexture.
+         * @param layers: bits of GetLayerBit (e.g. PLAYER_ATTACK for the bullets of the player), 0: no entity is hit.
+         * @return id of the simple entity, ComponentStore::INVALID_ID: if there are too many.
+         */
+        unsigned int AddSimpleEntity(const sf::Vector2f& position, const sf::Vector2f& velocity,
+                                     const sf::Vector2f& size, const sf::IntRect& textureRect,
+                                     float gravityScale = 0.0f, unsigned int layers = 0)
+        {
+            TransformComponent transform;
+            transform.position_ = position;
+
+            KinematicsComponent kinematics;
+            kinematics.velocity_ = velocity;
+            kinematics.gravity_scale_ = gravityScale;
+
+            CollisionBoxComponent collisionBox;
+            collisionBox.size_ = size;
+            collisionBox.bounds_ = sf::FloatRect(position.x - size.x / 2, position.y - size.y / 2, size.x, size.y);
+            collisionBox.layers_ = layers;
+
+            SpriteComponent sprite;
+            sprite.texture_rect_ = textureRect;
+
+            return simple_entities_.AddEntity(transform, kinematics, collisionBox, sprite);
+        }
+
+        /**
+         * \brief Remove a simple entity, nothing happens if it's been removed already (e.g. it hit a tile).
+         */
+        void RemoveSimpleEntity(unsigned int id)
+        {
+            simple_entities_.RemoveEntity(id);
         }
 
+        /**
+         * \brief Components of the simple entities, for systems and gameplay code to go through.
+         */
+        ComponentStore& GetSimpleEntities()
+        {
+            return simple_entities_;
+        }
+
+        /**
+         * \brief Set the texture every simple entity is drawn from.
+         * @param name: texture name in the texture manager, empty to release the current one.
+         */
+        void SetSimpleEntityTexture(const std::string& name)
+        {
+            if (!simple_entity_texture_name_.empty())
+                context_->texture_mgr_->ReleaseResource(simple_entity_texture_name_);
+
+            simple_entity_texture_name_.clear();
+            simple_entity_texture_ = nullptr;
+            if (name.empty() || !context_->texture_mgr_->RequireResource(name))
+                return;
+
+            simple_entity_texture_name_ = name;
+            simple_entity_texture_ = context_->texture_mgr_->GetResource(name);
+        }
+
+        /**
+         * @return nullptr: if the entity has been removed (stale handle).
+         */
         EntityBase* FindEntityById(unsigned int id)
         {
-            auto itr = entities_.find(id);
-            return (itr != entities_.end() ? itr->second : nullptr);
+            return handles_.Get(id);
         }
 
         EntityBase* FindEntityByName(const std::string& name)
         {
-            for (auto& itr : entities_)
+            EntityBase* result = nullptr;
+            handles_.ForEach([&name, &result](EntityBase* entity)
             {
-                if (itr.second->name_ == name)
-                    return itr.second;
-            }
-            return nullptr;
+                if (!result && entity->name_ == name)
+                    result = entity;
+            });
+            return result;
+        }
+
+        /**
+         * \brief Park entities: they are kept but not updated, collided or drawn (e.g. their part of the map is unloaded).
+         * @param isParked: return true if an entity at this position should be parked.
+         */
+        void ParkEntities(const std::function<bool(const sf::Vector2f&)>& isParked)
+        {
+            handles_.ForEach([this, &isParked](EntityBase* entity)
+            {
+                if (entity->proxy_id_ < 0 || !isParked(entity->current_position_)) // parked already?
+                    return;
+
+                entity_tree_.DestroyProxy(entity->proxy_id_);
+                entity->proxy_id_ = -1;
+                PutToSleep(entity);
+            });
+        }
+
+        /**
+         * \brief Wake up the parked entities which are in an area of the world.
+         */
+        void UnparkEntities(const sf::FloatRect& area)
+        {
+            handles_.ForEach([this, &area](EntityBase* entity)
+            {
+                if (entity->proxy_id_ >= 0 || !area.contains(entity->current_position_))
+                    return;
+
+                entity->proxy_id_ = entity_tree_.CreateProxy(entity->collision_bounding_box_, entity);
+                WakeEntity(entity, ActivityTier::ACTIVE);
+            });
         }
 
         void RemoveEntity(unsigned int id)
@@ -81,14 +215,95 @@ namespace SFMLTutorial
         }
 
         /**
-         * \brief Update all entities.
+         * \brief Wake up the sleeping entities in an area of the world (e.g. an alarm goes off),
+         * they are updated every step for a while even if they are far from the view space.
+         */
+        void WakeEntities(const sf::FloatRect& area)
+        {
+            entity_tree_.Query(area, [this, &area](EntityBase* entity)
+            {
+                if (area.intersects(entity->collision_bounding_box_))
+                    WakeEntity(entity, ActivityTier::ACTIVE);
+                return true;
+            });
+        }
+
+        /**
+         * \brief Wake up an entity (e.g. it's been called by another one), see WakeEntities.
+         */
+        void WakeEntity(unsigned int id)
+        {
+            EntityBase* entity = FindEntityById(id);
+            if (entity && entity->proxy_id_ >= 0) // parked entities stay parked.
+                WakeEntity(entity, ActivityTier::ACTIVE);
+        }
+
+        /**
+         * \brief Update the awake entities, in phases spread over the threads of the job system:
+         * integrate (EntityBase::Update), tile collisions (EntityBase::MoveAndCollide), pair detection,
+         * then on this thread the commit (tree, next map) and the collision callbacks, in a fixed order.
+         * Entities far from the view space are updated less often or sleep, see UpdateActivity.
          */
         void Update(float deltaTime)
         {
-            for (auto& itr : entities_)
+            ++step_count_;
+            UpdateActivity(deltaTime);
+
+            // the phases split a vector into ranges, in the order of awake_entities_.
+            update_list_.clear();
+            for (auto entity : awake_entities_)
             {
-                itr.second->Update(deltaTime);
+                entity->previous_position_ = entity->current_position_;
+                entity->activity_time_ += deltaTime;
+
+                // reduced entities take turns, a few of them every step.
+                if (entity->activity_ == ActivityTier::REDUCED &&
+                    (entity->id_ + step_count_) % REDUCED_UPDATE_INTERVAL != 0)
+                    continue;
+
+                update_list_.emplace_back(entity);
             }
+
+            if (!update_list_.empty())
+            {
+                Map* map = context_->game_map_;
+                JobSystem* jobSystem = context_->job_system_;
+                map->BuildTileColliders(); // the workers only read the tiles.
+
+                jobSystem->ParallelFor(update_list_.size(), ENTITIES_PER_RANGE,
+                                       [this](std::size_t begin, std::size_t end, unsigned int)
+                                       {
+                                           for (std::size_t i = begin; i < end; i++)
+                                           {
+                                               EntityBase* entity = update_list_[i];
+                                               entity->Update(entity->activity_time_);
+                                               entity->activity_time_ = 0.0f;
+                                           }
+                                       });
+
+                jobSystem->ParallelFor(update_list_.size(), ENTITIES_PER_RANGE,
+                                       [this](std::size_t begin, std::size_t end, unsigned int)
+                                       {
+                                           for (std::size_t i = begin; i < end; i++)
+                                           {
+                                               update_list_[i]->MoveAndCollide();
+                                           }
+                                       });
+
+                // side effects out of the entities are committed here, on a single thread.
+                bool isOnWarp = false;
+                for (auto entity : update_list_)
+                {
+                    entity_tree_.MoveProxy(entity->proxy_id_, entity->collision_bounding_box_);
+                    isOnWarp = isOnWarp || entity->is_on_warp_;
+                    entity->is_on_warp_ = false;
+                }
+
+                if (isOnWarp)
+                    map->LoadNextMap();
+            }
+
+            UpdateSimpleEntities(deltaTime);
             CheckEntityCollision();
             ProcessRemovals();
         }
@@ -101,27 +316,110 @@ namespace SFMLTutorial
             sf::RenderWindow& window = context_->window_->GetRenderWindow();
             sf::FloatRect viewSpace = context_->window_->GetViewSpace();
 
-            for (auto& itr : entities_)
+            // the order of the tree changes as entities move, the order of creation doesn't (later ones on top).
+            draw_list_.clear();
+            entity_tree_.Query(viewSpace, [this, &viewSpace](EntityBase* entity)
             {
-                if (!viewSpace.intersects(itr.second->collision_bounding_box_))
-                    continue;
+                if (viewSpace.intersects(entity->collision_bounding_box_))
+                    draw_list_.emplace_back(entity);
+                return true;
+            });
+            std::sort(draw_list_.begin(), draw_list_.end(), [](const EntityBase* first, const EntityBase* second)
+            {
+                return first->id_ < second->id_;
+            });
 
-                itr.second->Draw(&window);
+            for (auto entity : draw_list_)
+            {
+                entity->Draw(&window);
+            }
+
+            // every simple entity in a single draw call.
+            if (simple_entity_texture_ &&
+                EntitySystems::BuildSpriteVertices(simple_entities_, viewSpace, context_->interpolation_,
+                                                   simple_entity_vertices_) > 0)
+            {
+                sf::RenderStates states;
+                states.texture = simple_entity_texture_;
+                window.draw(simple_entity_vertices_, states);
             }
         }
 
+        /**
+         * \brief Get the entities whose bounding box intersects an area (e.g. an area attack).
+         */
+        void FindEntitiesInArea(const sf::FloatRect& area, std::vector<EntityBase*>& result) const
+        {
+            entity_tree_.Query(area, [&area, &result](EntityBase* entity)
+            {
+                if (area.intersects(entity->collision_bounding_box_))
+                    result.emplace_back(entity);
+                return true;
+            });
+        }
+
+        /**
+         * \brief Get the first entity hit by the segment [from, to] (e.g. line of sight).
+         * @param ignored: entity not to hit (e.g. the one casting the ray).
+         * @param hitPoint: where the segment enters the bounding box of the entity.
+         * @return nullptr: if no entity is hit.
+         */
+        EntityBase* RayCastEntities(const sf::Vector2f& from, const sf::Vector2f& to,
+                                    const EntityBase* ignored = nullptr, sf::Vector2f* hitPoint = nullptr) const
+        {
+            EntityBase* closest = nullptr;
+            float closestFraction = 1.0f;
+            entity_tree_.RayCast(from, to, [&](EntityBase* entity, float maxFraction)
+            {
+                float fraction;
+                if (entity == ignored || !AABBTree<EntityBase*>::IntersectSegment(
+                    entity->collision_bounding_box_, from, to, maxFraction, fraction))
+                    return maxFraction;
+
+                closest = entity;
+                closestFraction = fraction;
+                return fraction; // only closer entities from now on.
+            });
+
+            if (closest && hitPoint)
+                *hitPoint = from + (to - from) * closestFraction;
+            return closest;
+        }
+
+        /**
+         * \brief Get the entities of a type closest to a position (e.g. AI targeting), closest first.
+         * @param count: maximum number of entities.
+         * @param ignored: entity not to return (e.g. the one looking for targets).
+         */
+        void FindNearestEntities(const sf::Vector2f& position, unsigned int count, const EntityType& type,
+                                 std::vector<EntityBase*>& result, const EntityBase* ignored = nullptr) const
+        {
+            entity_tree_.FindNearest(position, count, [&position, &type, ignored](EntityBase* entity)
+            {
+                if (entity == ignored || entity->type_ != type)
+                    return -1.0f;
+
+                sf::Vector2f offset = entity->current_position_ - position;
+                return offset.x * offset.x + offset.y * offset.y;
+            }, result);
+        }
+
         /**
          * \brief Release, de-allocate all resources.
          */
         void Purge()
         {
-            for (auto& itr : entities_)
+            handles_.ForEach([this](EntityBase* entity)
             {
-                delete itr.second;
-            }
-            entities_.clear();
-
-            id_counter_ = 0;
+                DestroyEntity(entity);
+            });
+            awake_entities_.clear();
+            broad_phase_.Reset();
+            contact_cache_.Clear();
+            attack_cache_.Clear();
+            simple_attack_cache_.Clear();
+            entity_tree_.Clear();
+            simple_entities_.Clear();
         }
 
         SharedContext* GetContext()
@@ -129,32 +427,148 @@ namespace SFMLTutorial
             return context_;
         }
 
+        /**
+         * \brief Which collision layers interact, to be changed before the entities are updated.
+         */
+        CollisionMatrix& GetCollisionMatrix()
+        {
+            return collision_matrix_;
+        }
+
     private:
-        typedef std::unordered_map<unsigned int, EntityBase*> EntityContainer;
-        typedef std::unordered_map<EntityType, std::function<EntityBase*(void)>> EntityFactory;
+        friend class Benchmarks; // times the collision phases on entities of its own.
+
+        typedef std::unordered_map<EntityType, EntityPoolBase*> EntityFactory; // entity type -> its pool.
         // second argument: the character file path
         typedef std::unordered_map<std::string, std::string> EnemyTypes;
 
-        EntityContainer entities_;
         EnemyTypes enemy_types_;
         EntityFactory entity_factory_;
 
         SharedContext* context_;
-        unsigned int id_counter_; // highest ID was given to an entity 
-        unsigned int max_entities_;
+        unsigned int max_entities_; // alive and parked entities.
+        EntityHandles handles_; // id of an entity -> entity, alive and parked ones (without tree proxy).
 
         std::vector<unsigned int> entities_to_remove_;
 
         /**
-         * \brief Insert lambda functions into the entity factory container.
+         * \brief Box of an entity in the broad phase.
          */
-        template <class T>
-        void RegisterEntity(const EntityType& type)
+        struct CollisionProxy
         {
-            entity_factory_[type] = [this]()-> EntityBase*
+            EntityBase* entity_; // nullptr: a simple entity.
+            bool is_attack_; // the attack box, otherwise the bounding box. Simple entities attack.
+            unsigned int simple_index_; // of the simple entity in the component store.
+        };
+
+        static constexpr float BROAD_PHASE_CELL_SIZE = 64.0f; // in pixels, a few times a character.
+        SpatialGrid<CollisionProxy> broad_phase_; // rebuilt every frame by CheckEntityCollision.
+
+        static constexpr float ENTITY_TREE_MARGIN = 16.0f; // in pixels, moves within it don't update the tree.
+        AABBTree<EntityBase*> entity_tree_; // active entities, refreshed after every update.
+
+        ComponentStore simple_entities_; // entities without virtual update (e.g. bullets), see AddSimpleEntity.
+        std::vector<unsigned int> simple_entities_to_remove_;
+        sf::VertexArray simple_entity_vertices_;
+        std::string simple_entity_texture_name_;
+        sf::Texture* simple_entity_texture_;
+
+        static constexpr std::size_t ENTITIES_PER_RANGE = 32; // fewer entities are updated on this thread.
+        static constexpr std::size_t CELLS_PER_RANGE = 64; // of the broad phase grid.
+        std::vector<EntityBase*> update_list_; // awake entities being updated, see Update.
+        std::vector<EntityBase*> draw_list_; // visible entities by id, see Draw.
+
+        static constexpr float ACTIVE_MARGIN = 128.0f; // in pixels around the view space, updated every step within.
+        static constexpr float REDUCED_MARGIN = 512.0f; // updated every REDUCED_UPDATE_INTERVAL steps within.
+        static constexpr float ACTIVITY_HYSTERESIS = 64.0f; // in pixels, entities are demoted this far past a margin.
+        static constexpr unsigned int REDUCED_UPDATE_INTERVAL = 4; // in steps.
+        static constexpr float MIN_AWAKE_TIME = 2.0f; // in seconds, woken up entities don't fall asleep before.
+        std::vector<EntityBase*> awake_entities_; // active and reduced entities, see UpdateActivity.
+        unsigned int step_count_;
+
+        /**
+         * \brief Pair of entities whose boxes intersect.
+         */
+        struct Contact
+        {
+            EntityBase* first_; // attacker if is_attack_, nullptr: a simple entity.
+            EntityBase* second_;
+            bool is_attack_; // is it an attack box hitting a bounding box?
+            unsigned int simple_id_; // attacker if first_ is nullptr.
+        };
+
+        typedef std::vector<Contact> ContactList;
+        std::vector<ContactList> contact_lists_; // pairs found by each range of cells, see CheckEntityCollision.
+        ContactCache contact_cache_; // ids of the entities overlapping at the previous step.
+        ContactCache attack_cache_; // attacker and victim ids of the attacks hitting at the previous step.
+        ContactCache simple_attack_cache_; // same for the simple entities attacking, simple entity id first.
+        CollisionMatrix collision_matrix_;
+
+        /**
+         * \brief Bodies of the players touch everything but the enemies don't touch each other, nor do pickups,
+         * and attacks only hit the other side.
+         */
+        void SetDefaultCollisionMatrix()
+        {
+            collision_matrix_ = CollisionMatrix();
+            collision_matrix_.SetInteraction(CollisionLayer::PLAYER, CollisionLayer::PLAYER, true);
+            collision_matrix_.SetInteraction(CollisionLayer::PLAYER, CollisionLayer::ENEMY, true);
+            collision_matrix_.SetInteraction(CollisionLayer::PLAYER, CollisionLayer::PICKUP, true);
+            collision_matrix_.SetInteraction(CollisionLayer::PLAYER_ATTACK, CollisionLayer::ENEMY_HURT, true);
+            collision_matrix_.SetInteraction(CollisionLayer::ENEMY_ATTACK, CollisionLayer::PLAYER_HURT, true);
+        }
+
+        /**
+         * \brief Get the layers of the bounding box of the entities of a type, their body and where they can be hit.
+         */
+        static unsigned int GetDefaultCollisionLayers(const EntityType& type)
+        {
+            switch (type)
             {
-                return new T(this);
-            };
+            case EntityType::PLAYER:
+                return GetLayerBit(CollisionLayer::PLAYER) | GetLayerBit(CollisionLayer::PLAYER_HURT);
+            case EntityType::ENEMY:
+                return GetLayerBit(CollisionLayer::ENEMY) | GetLayerBit(CollisionLayer::ENEMY_HURT);
+            case EntityType::PICKUP:
+                return GetLayerBit(CollisionLayer::PICKUP);
+            default:
+                return ALL_COLLISION_LAYERS;
+            }
+        }
+
+        static unsigned int GetDefaultAttackLayers(const EntityType& type)
+        {
+            switch (type)
+            {
+            case EntityType::PLAYER:
+                return GetLayerBit(CollisionLayer::PLAYER_ATTACK);
+            case EntityType::ENEMY:
+                return GetLayerBit(CollisionLayer::ENEMY_ATTACK);
+            default:
+                return 0;
+            }
+        }
+
+        /**
+         * \brief Create the pool the entities of a type are constructed in.
+         * @param reserve: number of entities of the type expected, allocated right away (see EntityPool::Reserve).
+         */
+        template <class T>
+        void RegisterEntity(const EntityType& type, unsigned int reserve = 0)
+        {
+            EntityPoolBase*& pool = entity_factory_[type];
+            delete pool;
+            pool = new EntityPool<T>(this, max_entities_, reserve);
+        }
+
+        /**
+         * \brief Give the memory of an entity back to its pool, its handles become stale.
+         */
+        void DestroyEntity(EntityBase* entity)
+        {
+            EntityPoolBase* pool = handles_.Remove(entity->id_);
+            if (pool)
+                pool->Destroy(entity);
         }
 
         /**
@@ -164,17 +578,147 @@ namespace SFMLTutorial
         {
             while (entities_to_remove_.begin() != entities_to_remove_.end())
             {
-                unsigned int id = entities_to_remove_.back(); // last element
-                auto itr = entities_.find(id);
-                if (itr != entities_.end())
+                EntityBase* entity = handles_.Get(entities_to_remove_.back()); // last element
+                if (entity)
                 {
-                    delete itr->second;
-                    entities_.erase(itr);
+                    if (entity->proxy_id_ >= 0) // parked entities are asleep and out of the tree already.
+                    {
+                        PutToSleep(entity);
+                        entity_tree_.DestroyProxy(entity->proxy_id_);
+                    }
+                    DestroyEntity(entity);
                 }
                 entities_to_remove_.pop_back(); // remove the last element
             }
         }
 
+        /**
+         * \brief Promote and demote the entities between the activity tiers, from their distance to the view space.
+         * An entity is demoted ACTIVITY_HYSTERESIS past the margin it's promoted at, so entities on the edge
+         * don't switch tier every step. Only the awake entities and those around the view space are gone through.
+         */
+        void UpdateActivity(float deltaTime)
+        {
+            sf::FloatRect viewSpace = context_->window_->GetViewSpace();
+            sf::FloatRect activeArea = ExpandRect(viewSpace, ACTIVE_MARGIN);
+            sf::FloatRect reducedArea = ExpandRect(viewSpace, REDUCED_MARGIN);
+
+            // wake up the sleeping entities getting close.
+            entity_tree_.Query(reducedArea, [this, &reducedArea](EntityBase* entity)
+            {
+                if (entity->activity_ == ActivityTier::ASLEEP && reducedArea.contains(entity->current_position_))
+                    WakeEntity(entity, ActivityTier::REDUCED);
+                return true;
+            });
+
+            // backward, entities falling asleep are replaced by the last one.
+            sf::FloatRect keepActiveArea = ExpandRect(activeArea, ACTIVITY_HYSTERESIS);
+            sf::FloatRect keepReducedArea = ExpandRect(reducedArea, ACTIVITY_HYSTERESIS);
+            for (std::size_t i = awake_entities_.size(); i-- > 0;)
+            {
+                EntityBase* entity = awake_entities_[i];
+                entity->awake_time_ += deltaTime;
+
+                const sf::Vector2f& position = entity->current_position_;
+                ActivityTier tier;
+                if (activeArea.contains(position) ||
+                    (entity->activity_ == ActivityTier::ACTIVE && keepActiveArea.contains(position)))
+                    tier = ActivityTier::ACTIVE;
+                else if (keepReducedArea.contains(position))
+                    tier = ActivityTier::REDUCED;
+                else
+                    tier = ActivityTier::ASLEEP;
+
+                if (tier > entity->activity_ && entity->awake_time_ < MIN_AWAKE_TIME) // just woken up.
+                    continue;
+
+                if (tier == ActivityTier::ASLEEP)
+                    PutToSleep(entity);
+                else
+                    entity->activity_ = tier;
+            }
+        }
+
+        /**
+         * \brief Add an entity to the awake entities if it's asleep, and set its tier.
+         */
+        void WakeEntity(EntityBase* entity, const ActivityTier& tier)
+        {
+            if (entity->activity_index_ < 0)
+            {
+                entity->activity_index_ = static_cast<int>(awake_entities_.size());
+                awake_entities_.emplace_back(entity);
+                entity->activity_time_ = 0.0f;
+            }
+
+            entity->awake_time_ = 0.0f;
+            entity->activity_ = tier;
+        }
+
+        /**
+         * \brief Remove an entity from the awake entities, the last one takes its place.
+         */
+        void PutToSleep(EntityBase* entity)
+        {
+            if (entity->activity_index_ >= 0)
+            {
+                EntityBase* last = awake_entities_.back();
+                awake_entities_[entity->activity_index_] = last;
+                last->activity_index_ = entity->activity_index_;
+                awake_entities_.pop_back();
+            }
+
+            entity->activity_index_ = -1;
+            entity->activity_ = ActivityTier::ASLEEP;
+            entity->activity_time_ = 0.0f;
+        }
+
+        /**
+         * \brief Wake up the sleeping entities whose bounding box intersects a box, if they interact with it.
+         * @param layers, mask: of the box, see SpatialGrid::Insert.
+         */
+        void WakeTouchedEntities(const sf::FloatRect& box, unsigned int layers, unsigned int mask)
+        {
+            entity_tree_.Query(box, [this, &box, layers, mask](EntityBase* entity)
+            {
+                if (entity->activity_ != ActivityTier::ASLEEP || !(mask & entity->collision_layers_) ||
+                    !box.intersects(entity->collision_bounding_box_))
+                    return true;
+
+                unsigned int entityLayers = entity->collision_layers_;
+                if (collision_matrix_.GetMask(entityLayers) & entity->collision_mask_ & layers)
+                    WakeEntity(entity, ActivityTier::REDUCED);
+                return true;
+            });
+        }
+
+        static sf::FloatRect ExpandRect(const sf::FloatRect& rect, float margin)
+        {
+            return sf::FloatRect(rect.left - margin, rect.top - margin, rect.width + 2 * margin,
+                                 rect.height + 2 * margin);
+        }
+
+        /**
+         * \brief Run the systems over the simple entities, those hitting a tile are removed.
+         */
+        void UpdateSimpleEntities(float deltaTime)
+        {
+            if (simple_entities_.GetCount() == 0)
+                return;
+
+            Map* map = context_->game_map_;
+            simple_entities_.SavePreviousPositions();
+            EntitySystems::UpdateKinematics(simple_entities_, map->GetGravity(), deltaTime);
+            EntitySystems::UpdateCollisionBoxes(simple_entities_);
+            EntitySystems::FindTileHits(simple_entities_, *map, simple_entities_to_remove_);
+
+            for (auto id : simple_entities_to_remove_)
+            {
+                simple_entities_.RemoveEntity(id);
+            }
+            simple_entities_to_remove_.clear();
+        }
+
         /**
          * \brief Load pair of enemy names and their character definition files.
          */
@@ -202,52 +746,154 @@ namespace SFMLTutorial
         }
 
         /**
-         * \brief Check for collisions between entities.
+         * \brief Check for collisions between entities, then send the contact events of the step in a batch:
+         * enter (HandleCollisionWithOtherEntity), stay and exit, see EntityBase::HandleContact.
+         * Attacks are only sent when they start hitting a victim.
          */
         void CheckEntityCollision()
         {
-            if (entities_.empty())
-                return;
-
-            // check every entity against every other entity.
-            for (auto itr = entities_.begin(); std::next(itr) != entities_.end(); ++itr)
+            // an awake box touching a sleeping entity wakes it up, so their contact is tested instead of ending.
+            // simple entities first, the entities they wake up then wake up those they touch in turn.
+            const std::vector<CollisionBoxComponent>& simpleBoxes = simple_entities_.GetCollisionBoxes();
+            if (awake_entities_.size() < handles_.GetCount())
             {
-                for (auto nextItr = std::next(itr); nextItr != entities_.end(); ++nextItr)
+                for (auto& box : simpleBoxes)
                 {
-                    if (itr->first == nextItr->first) // same id?
-                        continue;
+                    if (box.layers_ != 0)
+                        WakeTouchedEntities(box.bounds_, box.layers_, collision_matrix_.GetMask(box.layers_));
+                }
 
-                    if (itr->second->collision_bounding_box_.intersects(nextItr->second->collision_bounding_box_))
-                        // collision?
-                    {
-                        // handling the collision.
-                        itr->second->HandleCollisionWithOtherEntity(nextItr->second, false);
-                        nextItr->second->HandleCollisionWithOtherEntity(itr->second, false);
-                    }
+                for (std::size_t i = 0; i < awake_entities_.size(); i++) // grows as entities wake up.
+                {
+                    EntityBase* entity = awake_entities_[i];
+                    WakeTouchedEntities(entity->collision_bounding_box_, entity->collision_layers_,
+                                        collision_matrix_.GetMask(entity->collision_layers_) & entity->collision_mask_);
+
+                    const sf::FloatRect* attackBox = entity->GetAttackBox();
+                    if (attackBox && entity->attack_layers_ != 0)
+                        WakeTouchedEntities(*attackBox, entity->attack_layers_,
+                                            collision_matrix_.GetMask(entity->attack_layers_));
+                }
+            }
 
-                    EntityType firstType = itr->second->type_;
-                    EntityType secondType = nextItr->second->type_;
-                    if (firstType == EntityType::PLAYER || firstType == EntityType::ENEMY)
-                    {
-                        /*Character* firstCharacter = dynamic_cast<Character*>(itr->second);
-                        if (firstCharacter)
-                        {
-                            if (firstCharacter->attack_box_.intersects(nextItr->second->collision_bounding_box_))
-                                firstCharacter->HandleCollisionWithOtherEntity(nextItr->second, true);
-                        }*/
-                    }
+            // only test entities sharing a cell of the broad phase grid, on layers interacting with each other.
+            // the entities still asleep touch no awake box, their contacts with each other are kept below.
+            broad_phase_.Clear();
+            for (auto entity : awake_entities_)
+            {
+                unsigned int mask = collision_matrix_.GetMask(entity->collision_layers_) & entity->collision_mask_;
+                broad_phase_.Insert({entity, false, 0}, entity->collision_bounding_box_, entity->collision_layers_,
+                                    mask);
+
+                const sf::FloatRect* attackBox = entity->GetAttackBox();
+                if (attackBox && entity->attack_layers_ != 0)
+                    broad_phase_.Insert({entity, true, 0}, *attackBox, entity->attack_layers_,
+                                        collision_matrix_.GetMask(entity->attack_layers_));
+            }
 
-                    if (secondType == EntityType::PLAYER || secondType == EntityType::ENEMY)
-                    {
-                        /*Character* secondCharacter = dynamic_cast<Character*>(nextItr->second);
-                        if (secondCharacter)
-                        {
-                            if (secondCharacter->attack_box_.intersects(itr->second->collision_bounding_box_))
-                                secondCharacter->HandleCollisionWithOtherEntity(itr->second, true);
-                        }*/
-                    }
+            // simple entities attack the bounding boxes, they don't hit each other nor attack boxes.
+            for (std::size_t i = 0; i < simpleBoxes.size(); i++)
+            {
+                if (simpleBoxes[i].layers_ != 0)
+                    broad_phase_.Insert({nullptr, true, static_cast<unsigned int>(i)}, simpleBoxes[i].bounds_,
+                                        simpleBoxes[i].layers_, collision_matrix_.GetMask(simpleBoxes[i].layers_));
+            }
+
+            // test the pairs on the workers, each range of cells in its own list.
+            JobSystem* jobSystem = context_->job_system_;
+            contact_lists_.resize(jobSystem->GetThreadCount());
+            for (auto& contacts : contact_lists_)
+            {
+                contacts.clear();
+            }
+
+            jobSystem->ParallelFor(broad_phase_.GetCellCount(), CELLS_PER_RANGE,
+                                   [this, &simpleBoxes](std::size_t begin, std::size_t end, unsigned int range)
+                                   {
+                                       ContactList& contacts = contact_lists_[range];
+                                       const std::vector<unsigned int>& simpleIds = simple_entities_.GetIds();
+                                       broad_phase_.ForEachPairInCells(begin, end, [&contacts, &simpleBoxes,
+                                           &simpleIds](const CollisionProxy& first, const CollisionProxy& second)
+                                       {
+                                           if (first.entity_ == second.entity_ ||
+                                               (first.is_attack_ && second.is_attack_))
+                                               return;
+
+                                           // hit: a bounding box, other: a bounding box or an attack box.
+                                           const CollisionProxy& hit = (first.is_attack_ ? second : first);
+                                           const CollisionProxy& other = (first.is_attack_ ? first : second);
+                                           const sf::FloatRect& hitBox = hit.entity_->collision_bounding_box_;
+                                           if (!hitBox.intersects(!other.entity_
+                                                                      ? simpleBoxes[other.simple_index_].bounds_
+                                                                      : other.is_attack_
+                                                                      ? *other.entity_->GetAttackBox()
+                                                                      : other.entity_->collision_bounding_box_))
+                                               return;
+
+                                           Contact contact;
+                                           contact.first_ = other.entity_;
+                                           contact.second_ = hit.entity_;
+                                           contact.is_attack_ = other.is_attack_;
+                                           contact.simple_id_ = (other.entity_ ? ComponentStore::INVALID_ID
+                                                                               : simpleIds[other.simple_index_]);
+                                           contacts.emplace_back(contact);
+                                       });
+                                   });
+
+            // lists merged by range: the order of a serial pass over the cells.
+            // pairs are compared to the previous step once every pair is found.
+            for (auto& contacts : contact_lists_)
+            {
+                for (auto& contact : contacts)
+                {
+                    if (!contact.is_attack_)
+                        contact_cache_.Add(contact.first_->id_, contact.second_->id_);
+                    else if (contact.first_)
+                        attack_cache_.AddDirected(contact.first_->id_, contact.second_->id_);
+                    else
+                        simple_attack_cache_.AddDirected(contact.simple_id_, contact.second_->id_);
                 }
             }
+
+            // pairs of sleeping entities aren't tested, their contacts go on.
+            auto isAsleep = [this](unsigned int firstId, unsigned int secondId)
+            {
+                EntityBase* first = FindEntityById(firstId);
+                EntityBase* second = FindEntityById(secondId);
+                return first && second && first->activity_ == ActivityTier::ASLEEP &&
+                    second->activity_ == ActivityTier::ASLEEP;
+            };
+            contact_cache_.KeepPrevious(isAsleep);
+            attack_cache_.KeepPrevious(isAsleep);
+
+            // handling the collisions, after the detection.
+            contact_cache_.Dispatch([this](ContactEvent event, unsigned int firstId, unsigned int secondId)
+            {
+                // an entity removed since the previous step only leaves an exit to the other one.
+                EntityBase* first = FindEntityById(firstId);
+                EntityBase* second = FindEntityById(secondId);
+                if (first)
+                    first->HandleContact(event, second);
+                if (second)
+                    second->HandleContact(event, first);
+            });
+
+            // an attack hits when its box starts intersecting the victim, not every step after.
+            attack_cache_.Dispatch([this](ContactEvent event, unsigned int attackerId, unsigned int victimId)
+            {
+                EntityBase* attacker = FindEntityById(attackerId);
+                EntityBase* victim = FindEntityById(victimId);
+                if (event == ContactEvent::ENTER && attacker && victim)
+                    attacker->HandleCollisionWithOtherEntity(victim, true);
+            });
+
+            // a simple entity hits once and is removed, the first victim in the order of the pairs.
+            simple_attack_cache_.Dispatch([this](ContactEvent event, unsigned int simpleId, unsigned int victimId)
+            {
+                EntityBase* victim = FindEntityById(victimId);
+                if (event == ContactEvent::ENTER && victim && simple_entities_.RemoveEntity(simpleId))
+                    victim->HandleCollisionWithOtherEntity(nullptr, true);
+            });
         }
     };
 }
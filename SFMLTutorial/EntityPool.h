@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <new>
+#include <type_traits>
+
+namespace SFMLTutorial
+{
+    class EntityBase;
+    class EntityManager;
+
+    /**
+     * \brief Storage of the entities of a type, see EntityPool.
+     */
+    class EntityPoolBase
+    {
+    public:
+        virtual ~EntityPoolBase()
+        {
+        }
+
+        /**
+         * @return nullptr: if the pool can't grow any more.
+         */
+        virtual EntityBase* Create() = 0;
+
+        virtual void Destroy(EntityBase* entity) = 0;
+    };
+
+    /**
+     * \brief Entities of a type constructed in slabs (blocks of SLAB_SIZE entities allocated at once),
+     * destroyed entities go to a free list and their memory is reused by the next ones.
+     * The heap is only touched when every slab is full, slabs for the expected count can be allocated up front.
+     */
+    template <class T>
+    class EntityPool : public EntityPoolBase
+    {
+    public:
+        static constexpr unsigned int SLAB_SIZE = 64;
+
+        /**
+         * @param capacity: maximum number of entities.
+         * @param reserve: number of entities allocated right away, at least a slab.
+         */
+        EntityPool(EntityManager* entityMgr, unsigned int capacity, unsigned int reserve) : entity_mgr_(entityMgr),
+                                                                                            capacity_(capacity)
+        {
+            AddSlab();
+            Reserve(reserve);
+        }
+
+        ~EntityPool()
+        {
+            // entities still alive are owned by the entity manager, which destroys them before its pools.
+            for (auto slab : slabs_)
+            {
+                delete[] slab;
+            }
+        }
+
+        EntityPool(const EntityPool&) = delete;
+        EntityPool& operator=(const EntityPool&) = delete;
+
+        EntityBase* Create() override
+        {
+            if (free_.empty() && !AddSlab())
+                return nullptr;
+
+            Slot* slot = free_.back();
+            free_.pop_back();
+            return new(slot) T(entity_mgr_);
+        }
+
+        void Destroy(EntityBase* entity) override
+        {
+            T* object = static_cast<T*>(entity);
+            object->~T();
+            free_.emplace_back(reinterpret_cast<Slot*>(object));
+        }
+
+        /**
+         * \brief Allocate slabs until there is room for a number of entities (capped by the capacity),
+         * so spawning them later doesn't touch the heap.
+         */
+        void Reserve(unsigned int count)
+        {
+            while (GetAllocatedCount() < count && AddSlab())
+            {
+            }
+        }
+
+    private:
+        typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+        EntityManager* entity_mgr_;
+        unsigned int capacity_;
+        std::vector<Slot*> slabs_;
+        std::vector<Slot*> free_; // slots without entity.
+
+        unsigned int GetAllocatedCount() const
+        {
+            unsigned int allocated = static_cast<unsigned int>(slabs_.size()) * SLAB_SIZE;
+            return (allocated < capacity_ ? allocated : capacity_); // only the last slab may be smaller.
+        }
+
+        bool AddSlab()
+        {
+            unsigned int allocated = GetAllocatedCount();
+            if (allocated >= capacity_)
+                return false;
+
+            unsigned int size = (capacity_ - allocated < SLAB_SIZE ? capacity_ - allocated : SLAB_SIZE);
+            Slot* slab = new Slot[size];
+            slabs_.emplace_back(slab);
+
+            free_.reserve(allocated + size);
+            for (unsigned int i = size; i > 0; i--) // first slot on top of the free list.
+            {
+                free_.emplace_back(&slab[i - 1]);
+            }
+            return true;
+        }
+    };
+
+    /**
+     * \brief Table of 32-bit generational handles to entities: slot index in the low INDEX_BITS bits,
+     * generation of the slot in the high bits. The generation changes when an entity is removed,
+     * so the handles of a removed entity no longer resolve, even once its slot is reused.
+     */
+    class EntityHandles
+    {
+    public:
+        static constexpr unsigned int INDEX_BITS = 20;
+        static constexpr unsigned int INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static constexpr unsigned int GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+        static constexpr unsigned int MAX_COUNT = INDEX_MASK; // index INDEX_MASK is never used.
+        static constexpr unsigned int INVALID_HANDLE = 0xFFFFFFFF;
+
+        explicit EntityHandles(unsigned int capacity) : count_(0)
+        {
+            slots_.reserve(capacity < MAX_COUNT ? capacity : MAX_COUNT);
+            free_.reserve(slots_.capacity());
+        }
+
+        /**
+         * @param pool: pool the entity comes from.
+         * @return INVALID_HANDLE: if there are MAX_COUNT handles already.
+         */
+        unsigned int Add(EntityBase* entity, EntityPoolBase* pool)
+        {
+            unsigned int index;
+            if (!free_.empty())
+            {
+                index = free_.back();
+                free_.pop_back();
+            }
+            else
+            {
+                if (slots_.size() >= MAX_COUNT)
+                    return INVALID_HANDLE;
+
+                index = static_cast<unsigned int>(slots_.size());
+                slots_.emplace_back();
+            }
+
+            Slot& slot = slots_[index];
+            slot.entity_ = entity;
+            slot.pool_ = pool;
+            ++count_;
+            return (slot.generation_ << INDEX_BITS) | index;
+        }
+
+        /**
+         * \brief Forget an entity, every handle to it becomes stale.
+         * @return pool of the entity, nullptr: if the handle is stale.
+         */
+        EntityPoolBase* Remove(unsigned int handle)
+        {
+            Slot* slot = GetSlot(handle);
+            if (!slot)
+                return nullptr;
+
+            EntityPoolBase* pool = slot->pool_;
+            slot->entity_ = nullptr;
+            slot->pool_ = nullptr;
+            slot->generation_ = (slot->generation_ + 1) & GENERATION_MASK;
+            free_.emplace_back(handle & INDEX_MASK);
+            --count_;
+            return pool;
+        }
+
+        /**
+         * @return nullptr: if the handle is stale or invalid.
+         */
+        EntityBase* Get(unsigned int handle) const
+        {
+            const Slot* slot = GetSlot(handle);
+            return (slot ? slot->entity_ : nullptr);
+        }
+
+        /**
+         * \brief Call a function for every entity, in slot order. The function may remove the entity it's given.
+         * @param function: void(EntityBase* entity).
+         */
+        template <typename Function>
+        void ForEach(Function function) const
+        {
+            for (std::size_t i = 0; i < slots_.size(); i++)
+            {
+                if (slots_[i].entity_)
+                    function(slots_[i].entity_);
+            }
+        }
+
+        void Clear()
+        {
+            // keep the generations, handles given before must stay stale.
+            free_.clear();
+            for (unsigned int i = 0; i < slots_.size(); i++)
+            {
+                if (slots_[i].entity_)
+                {
+                    slots_[i].entity_ = nullptr;
+                    slots_[i].pool_ = nullptr;
+                    slots_[i].generation_ = (slots_[i].generation_ + 1) & GENERATION_MASK;
+                }
+                free_.emplace_back(i);
+            }
+            count_ = 0;
+        }
+
+        unsigned int GetCount() const
+        {
+            return count_;
+        }
+
+    private:
+        struct Slot
+        {
+            EntityBase* entity_ = nullptr;
+            EntityPoolBase* pool_ = nullptr;
+            unsigned int generation_ = 0;
+        };
+
+        std::vector<Slot> slots_;
+        std::vector<unsigned int> free_; // indices of the slots without entity.
+        unsigned int count_;
+
+        Slot* GetSlot(unsigned int handle)
+        {
+            return const_cast<Slot*>(static_cast<const EntityHandles*>(this)->GetSlot(handle));
+        }
+
+        const Slot* GetSlot(unsigned int handle) const
+        {
+            unsigned int index = handle & INDEX_MASK;
+            if (index >= slots_.size())
+                return nullptr;
+
+            const Slot& slot = slots_[index];
+            if (!slot.entity_ || slot.generation_ != (handle >> INDEX_BITS))
+                return nullptr;
+            return &slot;
+        }
+    };
+}
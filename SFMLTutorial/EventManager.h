@@ -1,13 +1,18 @@
 #pragma once
 
 #include "pch.h"
+#include "InputState.h"
+#include "InputSampler.h"
 #include <utility>
+#include <cstdint>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <functional>
 #include <fstream>
 #include <sstream>
+#include <memory>
 
 namespace SFMLTutorial
 {
@@ -74,14 +79,16 @@ namespace SFMLTutorial
             mouse_ = sf::Vector2i(0, 0);
             mouse_wheel_delta_ = 0;
             keycode_ = -1;
+            time_ = sf::Time::Zero;
         }
 
-        std::string name_;
+        const std::string& name_; // name of the binding, not copied.
         sf::Vector2i size_;
         sf::Uint32 text_entered_;
         sf::Vector2i mouse_;
         int mouse_wheel_delta_;
         int keycode_;
+        sf::Time time_; // when the binding was satisfied (last event or chord), see EventManager::GetTime.
     };
 
     /**
@@ -89,7 +96,8 @@ namespace SFMLTutorial
      */
     struct Binding
     {
-        Binding(const std::string& name) : name_(name), count_events_happening_(0), details_(name)
+        Binding(const std::string& name) : name_(name), id_(0), count_events_happening_(0), required_event_count_(0),
+                                           details_(name_)
         {
         }
 
@@ -103,14 +111,18 @@ namespace SFMLTutorial
 
         Events events_;
         std::string name_;
+        unsigned int id_; // index of the binding in the callback tables, given by EventManager::AddBinding.
         int count_events_happening_;
+        // compiled from events_ by EventManager::AddBinding:
+        InputState required_inputs_; // keys and buttons held (KEYBOARD and MOUSE events), a chord.
+        int required_event_count_; // events to be received during the frame (the others).
         EventDetails details_;
     };
 
     class EventManager
     {
     public:
-        EventManager()
+        EventManager() : current_callbacks_(nullptr), global_callbacks_(&callbacks_[StateType(0)])
         {
             LoadBindings();
         }
@@ -124,12 +136,28 @@ namespace SFMLTutorial
             }
         }
 
+        /**
+         * \brief Add a binding, its events must be bound before (see Binding::BindEvent), they are indexed here.
+         */
         bool AddBinding(Binding* binding)
         {
             if (bindings_.find(binding->name_) != bindings_.end()) // binding name has already existed?
                 return false;
 
-            return bindings_.emplace(binding->name_, binding).second;
+            if (!bindings_.emplace(binding->name_, binding).second)
+                return false;
+
+            binding->id_ = GetBindingId(binding->name_);
+            if (binding->id_ >= binding_list_.size())
+                binding_list_.resize(binding->id_ + 1, nullptr);
+            binding_list_[binding->id_] = binding;
+
+            CompileBinding(binding);
+            IndexBinding(binding);
+            bound_inputs_.Merge(binding->required_inputs_);
+            if (input_sampler_)
+                input_sampler_->SetInputs(bound_inputs_);
+            return true;
         }
 
         bool RemoveBinding(std::string name)
@@ -138,162 +166,273 @@ namespace SFMLTutorial
             if (itr == bindings_.end()) // is name not existed?
                 return false;
 
+            UnindexBinding(itr->second);
+            binding_list_[itr->second->id_] = nullptr; // the id stays, callbacks may still refer to it.
             delete itr->second;
             bindings_.erase(itr);
+
+            bound_inputs_.Clear();
+            for (auto& bindingItr : bindings_)
+            {
+                bound_inputs_.Merge(bindingItr.second->required_inputs_);
+            }
+            if (input_sampler_)
+                input_sampler_->SetInputs(bound_inputs_);
             return true;
         }
 
+        /**
+         * \brief Sample the keys and buttons bound to an action on a thread, many times per frame,
+         * instead of once per update: presses shorter than a frame are caught, and the time a binding
+         * was satisfied within the frame is kept in EventDetails::time_ (e.g. for precise jump windows).
+         * @param interval: time between two samples.
+         */
+        void StartInputThread(sf::Time interval = sf::milliseconds(1))
+        {
+            input_sampler_.reset(); // restarted with the new interval.
+            last_sample_ = InputSample();
+            input_sampler_.reset(new InputSampler(&clock_, interval));
+            input_sampler_->SetInputs(bound_inputs_);
+        }
+
+        void StopInputThread()
+        {
+            input_sampler_.reset();
+        }
+
+        bool IsInputThreadRunning() const
+        {
+            return input_sampler_ != nullptr;
+        }
+
+        /**
+         * \brief Get time on the clock of the samples (see EventDetails::time_).
+         */
+        sf::Time GetTime() const
+        {
+            return clock_.getElapsedTime();
+        }
+
         void SetFocus(const bool& focus)
         {
             is_window_focused_ = focus;
         }
 
+        /**
+         * \brief Call a member function when a binding is satisfied while a state is current,
+         * StateType(0): whatever the current state (e.g. window callbacks).
+         * @param name: name of the binding, it may be added later.
+         * @return false: if the state already has a callback for this binding.
+         */
         template <class T>
         bool AddCallback(StateType state, const std::string& name, void (T::*func)(EventDetails*), T* instance)
         {
-            // emplace returns pair<iterator, bool>
-            auto itr = callbacks_.emplace(state, CallbackContainer()).first; // get iterator
-            auto temp = std::bind(func, instance, std::placeholders::_1);
-            return itr->second.emplace(name, temp).second; // get bool
-            // return callbacks_.emplace(name, temp).second; // second is std::function...
+            unsigned int id = GetBindingId(name);
+            CallbackTable& table = callbacks_[state];
+            if (id >= table.size())
+                table.resize(id + 1);
+            if (table[id])
+                return false;
+
+            table[id] = [instance, func](EventDetails* details)
+            {
+                (instance->*func)(details);
+            };
+            return true;
         }
 
         bool RemoveCallback(StateType state, const std::string& name)
         {
-            auto itr = callbacks_.find(state);
-            if (itr == callbacks_.end())
+            auto stateItr = callbacks_.find(state);
+            auto idItr = binding_ids_.find(name);
+            if (stateItr == callbacks_.end() || idItr == binding_ids_.end())
                 return false;
 
-            auto callbackContainerItr = itr->second.find(name);
-            if (callbackContainerItr == itr->second.end())
+            CallbackTable& table = stateItr->second;
+            if (idItr->second >= table.size() || !table[idItr->second])
                 return false;
 
-            itr->second.erase(name);
+            table[idItr->second] = nullptr;
             return true;
         }
 
+        /**
+         * \brief Count an event for the bindings waiting for it, found in the event index by type and code.
+         */
         void HandleEvent(sf::Event& event)
         {
-            for (auto& bindingItr : bindings_)
-            {
-                Binding* bind = bindingItr.second;
-                for (auto& eventItr : bind->events_)
-                {
-                    EventType sfmlEvent = static_cast<EventType>(event.type);
-                    if (eventItr.first != sfmlEvent)
-                        continue;
+            EventType sfmlEvent = static_cast<EventType>(event.type);
+            int code = ANY_CODE;
+            if (sfmlEvent == EventType::KEY_DOWN || sfmlEvent == EventType::KEY_UP)
+                code = event.key.code;
+            else if (sfmlEvent == EventType::MOUSE_BUTTON_DOWN || sfmlEvent == EventType::MOUSE_BUTTON_UP)
+                code = event.mouseButton.button;
+
+            auto indexItr = event_index_.find(MakeEventKey(sfmlEvent, code));
+            if (indexItr == event_index_.end())
+                return;
 
-					// @formatter:off
-                    // check if it's a keyboard event
-                    if (sfmlEvent == EventType::KEY_DOWN || sfmlEvent == EventType::KEY_UP) // is matching type?
-                    {
-                        if (eventItr.second.code_of_key_pressed_ == event.key.code) // is matching code?
-                        {
-                            if (bind->details_.keycode_ != -1)
-                                bind->details_.keycode_ = eventItr.second.code_of_key_pressed_;
-
-                            (bind->count_events_happening_)++;
-                            break;
-                        }
-                    }
-                    else if (sfmlEvent == EventType::MOUSE_BUTTON_DOWN || sfmlEvent == EventType::MOUSE_BUTTON_UP) // mouse event?
-                    {
-                        if (eventItr.second.code_of_key_pressed_ == event.mouseButton.button)
-                        {
-                            bind->details_.mouse_.x = event.mouseButton.x;
-                            bind->details_.mouse_.y = event.mouseButton.y;
+            const sf::Time time = GetTime(); // when the event is received (e.g. in Window::Update).
 
-                            if (bind->details_.keycode_ != -1)
-                                bind->details_.keycode_ = eventItr.second.code_of_key_pressed_;
+            for (Binding* bind : indexItr->second)
+            {
+				// @formatter:off
+                // check if it's a keyboard event
+                if (sfmlEvent == EventType::KEY_DOWN || sfmlEvent == EventType::KEY_UP) // is matching type?
+                {
+                    if (bind->details_.keycode_ != -1)
+                        bind->details_.keycode_ = code;
+                }
+                else if (sfmlEvent == EventType::MOUSE_BUTTON_DOWN || sfmlEvent == EventType::MOUSE_BUTTON_UP) // mouse event?
+                {
+                    bind->details_.mouse_.x = event.mouseButton.x;
+                    bind->details_.mouse_.y = event.mouseButton.y;
 
-                            (bind->count_events_happening_)++;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        if (sfmlEvent == EventType::MOUSE_WHEEL)
-                        {
-                            bind->details_.mouse_wheel_delta_ = event.mouseWheel.delta;
-                        }
-                        else if (sfmlEvent == EventType::WINDOW_RESIZED)
-                        {
-                            bind->details_.size_.x = event.size.width;
-                            bind->details_.size_.y = event.size.height;
-                        }
-                        else if (sfmlEvent == EventType::TEXT_ENTERED)
-                        {
-                            bind->details_.text_entered_ = event.text.unicode;
-                        }
-
-                        (bind->count_events_happening_)++;
-                    }
-                    // @formatter:on
+                    if (bind->details_.keycode_ != -1)
+                        bind->details_.keycode_ = code;
+                }
+                else if (sfmlEvent == EventType::MOUSE_WHEEL)
+                {
+                    bind->details_.mouse_wheel_delta_ = event.mouseWheel.delta;
+                }
+                else if (sfmlEvent == EventType::WINDOW_RESIZED)
+                {
+                    bind->details_.size_.x = event.size.width;
+                    bind->details_.size_.y = event.size.height;
                 }
+                else if (sfmlEvent == EventType::TEXT_ENTERED)
+                {
+                    bind->details_.text_entered_ = event.text.unicode;
+                }
+                // @formatter:on
+
+                (bind->count_events_happening_)++;
+                bind->details_.time_ = time;
             }
         }
 
+        /**
+         * \brief Take a snapshot of the keys and buttons bound to an action (or the samples of the input thread),
+         * then run the callbacks of the bindings satisfied this frame.
+         */
         void Update()
         {
+            if (input_sampler_)
+            {
+                DrainSamples(); // even unfocused, so samples don't pile up.
+                if (is_window_focused_)
+                    Dispatch();
+                return;
+            }
+
             if (!is_window_focused_)
                 return;
 
-            for (auto& bindingItr : bindings_)
-            {
-                Binding* bind = bindingItr.second;
-                for (auto& eventItr : bind->events_)
-                {
-                    switch (eventItr.first)
-                    {
-                    case EventType::KEYBOARD:
-                        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key(eventItr.second.code_of_key_pressed_)))
-                        {
-                            if (bind->details_.keycode_ != -1)
-                                bind->details_.keycode_ = eventItr.second.code_of_key_pressed_;
-
-                            (bind->count_events_happening_)++;
-                        }
-                        break;
+            // a single sweep over the devices for every binding.
+            Update(InputState::Poll(bound_inputs_));
+        }
 
-                    case EventType::MOUSE:
-                        if (sf::Mouse::isButtonPressed(sf::Mouse::Button(eventItr.second.code_of_key_pressed_)))
-                        {
-                            if (bind->details_.keycode_ != -1)
-                                bind->details_.keycode_ = eventItr.second.code_of_key_pressed_;
+        /**
+         * \brief Run the callbacks of the bindings satisfied by a snapshot of the devices
+         * and the events handled since the last update (e.g. input from a replay).
+         */
+        void Update(const InputState& inputState)
+        {
+            samples_.clear();
+            samples_.push_back({inputState, GetTime()});
+            Dispatch();
+        }
 
-                            (bind->count_events_happening_)++;
-                        }
-                        break;
+        /**
+         * \brief Get the keys and buttons held at the last update, only those bound to an action are known.
+         */
+        const InputState& GetInputState() const
+        {
+            return input_state_;
+        }
 
-                    case EventType::JOYSTICK:
-                        // Expansion in the future.
-                        break;
+        sf::Vector2i GetMousePosition(sf::RenderWindow* window = nullptr)
+        {
+            return (window ? sf::Mouse::getPosition(*window) : sf::Mouse::getPosition());
+        }
 
-                    default:
-                        break;
-                    }
-                }
+        /**
+         * \brief Make the callbacks of a state the ones called, the table is created if the state has none yet.
+         */
+        void SetCurrentState(StateType state)
+        {
+            current_state_ = state;
+            current_callbacks_ = &callbacks_[state]; // elements of an unordered_map don't move.
+        }
 
-                // is matching number of events in the event container and events that are "on"?
-                if (bind->events_.size() == bind->count_events_happening_)
-                {
-                    auto stateCallbacksItr = callbacks_.find(current_state_);
-                    auto otherCallbacksItr = callbacks_.find(StateType(0));
-                    // process global callbacks for the Window class.
+    private:
+        typedef std::unordered_map<std::string, Binding*> Bindings;
+        typedef std::unordered_map<std::string, unsigned int> BindingIds;
+        typedef std::vector<std::function<void(EventDetails*)>> CallbackTable; // binding id -> callback.
+        typedef std::unordered_map<StateType, CallbackTable> Callbacks;
+        // (event type, code) -> bindings counting the event, once per matching event (once for keys and buttons).
+        typedef std::unordered_map<std::uint64_t, std::vector<Binding*>> EventIndex;
 
-                    if (stateCallbacksItr != callbacks_.end())
-                    {
-                        auto callItr = stateCallbacksItr->second.find(bind->name_);
-                        if (callItr != stateCallbacksItr->second.end()) // if found -> call function accordingly.
-                            callItr->second(&(bind->details_));
-                    }
+        static constexpr int ANY_CODE = -1; // code of the events matched by type only (e.g. mouse wheel).
 
-                    if (otherCallbacksItr != callbacks_.end())
-                    {
-                        auto callItr = otherCallbacksItr->second.find(bind->name_);
-                        if (callItr != otherCallbacksItr->second.end()) // if found -> call function accordingly.
-                            callItr->second(&(bind->details_));
-                    }
+        Bindings bindings_;
+        BindingIds binding_ids_; // ids are dense and never reused, a removed binding keeps its id.
+        std::vector<Binding*> binding_list_; // binding id -> binding, nullptr: removed or not added yet.
+        EventIndex event_index_;
+        InputState bound_inputs_; // keys and buttons of every binding, the ones polled by Update.
+        InputState input_state_; // snapshot of the last update.
+        sf::Clock clock_; // time base of the samples.
+        std::vector<InputSample> samples_; // states of the devices during the frame, in order.
+        InputSample last_sample_; // state of the devices since the last change drained.
+        sf::Time update_time_; // time of the last dispatch.
+        std::unique_ptr<InputSampler> input_sampler_; // nullptr: devices polled by Update.
+        Callbacks callbacks_;
+        CallbackTable* current_callbacks_; // table of current_state_, swapped by SetCurrentState.
+        CallbackTable* global_callbacks_; // table of StateType(0).
+        StateType current_state_;
+        bool is_window_focused_ = true;
+
+        /**
+         * \brief Take the samples pushed by the input thread since the last update, after the state held
+         * before them.
+         */
+        void DrainSamples()
+        {
+            samples_.clear();
+            samples_.push_back(last_sample_);
+
+            InputSample sample;
+            while (input_sampler_->Pop(sample))
+            {
+                samples_.push_back(sample);
+            }
+            last_sample_ = samples_.back();
+        }
+
+        /**
+         * \brief Run the callbacks of the bindings satisfied by the samples of the frame and the events handled
+         * since the last update.
+         */
+        void Dispatch()
+        {
+            input_state_ = samples_.back().state_;
+            update_time_ = GetTime();
+            for (Binding* bind : binding_list_)
+            {
+                if (!bind) // removed.
+                    continue;
+
+                // all the events received and the chord held at some point?
+                sf::Time chordTime;
+                if (bind->count_events_happening_ == bind->required_event_count_ && FindSatisfiedTime(bind, chordTime))
+                {
+                    // satisfied by the later of its last event and its chord.
+                    if (chordTime > bind->details_.time_)
+                        bind->details_.time_ = chordTime;
+
+                    // callbacks of the current state, then global callbacks for the Window class.
+                    Call(current_callbacks_, bind);
+                    Call(global_callbacks_, bind);
                 }
 
                 // reset
@@ -302,25 +441,118 @@ namespace SFMLTutorial
             }
         }
 
-        sf::Vector2i GetMousePosition(sf::RenderWindow* window = nullptr)
+        /**
+         * \brief Find the first sample of the frame holding the chord of a binding, a chord pressed and released
+         * within the frame counts.
+         * @param time: set to the time of the sample, or of the update without chord and events.
+         * @return false: if no sample holds the chord.
+         */
+        bool FindSatisfiedTime(const Binding* bind, sf::Time& time) const
         {
-            return (window ? sf::Mouse::getPosition(*window) : sf::Mouse::getPosition());
+            if (bind->required_inputs_.IsEmpty())
+            {
+                // timed by its events, if any.
+                time = (bind->required_event_count_ > 0 ? sf::Time::Zero : update_time_);
+                return true;
+            }
+
+            for (const InputSample& sample : samples_)
+            {
+                if (sample.state_.Contains(bind->required_inputs_))
+                {
+                    time = sample.time_;
+                    return true;
+                }
+            }
+            return false;
         }
 
-        void SetCurrentState(StateType state)
+        /**
+         * \brief Get the id of a binding name, a new one if the name is unknown.
+         */
+        unsigned int GetBindingId(const std::string& name)
         {
-            current_state_ = state;
+            return binding_ids_.emplace(name, static_cast<unsigned int>(binding_ids_.size())).first->second;
         }
 
-    private:
-        typedef std::unordered_map<std::string, Binding*> Bindings;
-        typedef std::unordered_map<std::string, std::function<void(EventDetails*)>> CallbackContainer;
-        typedef std::unordered_map<StateType, CallbackContainer> Callbacks;
+        /**
+         * \brief Call the callback of a binding in a table, if any.
+         */
+        static void Call(const CallbackTable* table, Binding* bind)
+        {
+            if (!table || bind->id_ >= table->size() || !(*table)[bind->id_])
+                return;
 
-        Bindings bindings_;
-        Callbacks callbacks_;
-        StateType current_state_;
-        bool is_window_focused_ = true;
+            // copied: the callback may add callbacks (e.g. a state switch creating a state) and grow the table.
+            auto callback = (*table)[bind->id_];
+            callback(&(bind->details_));
+        }
+
+        static std::uint64_t MakeEventKey(EventType type, int code)
+        {
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(type)) << 32) |
+                static_cast<std::uint32_t>(code);
+        }
+
+        /**
+         * \brief Turn the held keys and buttons of a binding into a mask, and count the events it waits for.
+         */
+        static void CompileBinding(Binding* binding)
+        {
+            binding->required_inputs_.Clear();
+            binding->required_event_count_ = 0;
+            for (auto& eventItr : binding->events_)
+            {
+                bool isHeld;
+                if (eventItr.first == EventType::KEYBOARD)
+                    isHeld = binding->required_inputs_.SetKey(eventItr.second.code_of_key_pressed_, true);
+                else if (eventItr.first == EventType::MOUSE)
+                    isHeld = binding->required_inputs_.SetButton(eventItr.second.code_of_key_pressed_, true);
+                else
+                    isHeld = false;
+
+                // events never counted (e.g. unknown key, joystick for now) keep the binding from firing.
+                if (!isHeld)
+                    ++(binding->required_event_count_);
+            }
+        }
+
+        /**
+         * \brief Add the events of a binding sent by SFML to the event index, polled ones (e.g. KEYBOARD)
+         * are checked by Update.
+         */
+        void IndexBinding(Binding* binding)
+        {
+            for (auto& eventItr : binding->events_)
+            {
+                EventType type = eventItr.first;
+                if (type >= EventType::KEYBOARD)
+                    continue;
+
+                bool isCoded = (type == EventType::KEY_DOWN || type == EventType::KEY_UP ||
+                    type == EventType::MOUSE_BUTTON_DOWN || type == EventType::MOUSE_BUTTON_UP);
+                std::vector<Binding*>& matches = event_index_[MakeEventKey(
+                    type, isCoded ? eventItr.second.code_of_key_pressed_ : ANY_CODE)];
+
+                // a key or a button counts once per binding, even if it's bound twice.
+                if (isCoded && std::find(matches.begin(), matches.end(), binding) != matches.end())
+                    continue;
+                matches.emplace_back(binding);
+            }
+        }
+
+        void UnindexBinding(Binding* binding)
+        {
+            for (auto itr = event_index_.begin(); itr != event_index_.end();)
+            {
+                std::vector<Binding*>& matches = itr->second;
+                matches.erase(std::remove(matches.begin(), matches.end(), binding), matches.end());
+                if (matches.empty())
+                    itr = event_index_.erase(itr);
+                else
+                    ++itr;
+            }
+        }
 
         /**
          * \brief Load binding from a file.
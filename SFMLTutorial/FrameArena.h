@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <new>
+#include <vector>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Linear allocator for memory living at most until the end of the frame (see Game::LateUpdate).
+     * Allocating moves an offset forward, freeing does nothing, the whole arena is emptied at once by Reset.
+     * Allocations are thread-safe (e.g. from jobs). When the arena is full, allocations go to the heap
+     * and the arena grows at the next reset, so a steady frame ends up never touching the heap.
+     */
+    class FrameArena
+    {
+    public:
+        explicit FrameArena(std::size_t capacity) : buffer_(nullptr), capacity_(0), used_(0), peak_used_(0),
+                                                    overflow_count_(0), overflow_size_(0)
+        {
+            Grow(capacity);
+        }
+
+        ~FrameArena()
+        {
+            ::operator delete(buffer_);
+        }
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        /**
+         * @param alignment: power of 2.
+         * @return memory valid until Reset, from the heap if the arena is full.
+         */
+        void* Allocate(std::size_t size, std::size_t alignment)
+        {
+            std::size_t used = used_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                std::uintptr_t address = reinterpret_cast<std::uintptr_t>(buffer_) + used;
+                std::size_t offset = used + ((alignment - address % alignment) % alignment);
+                if (offset + size > capacity_)
+                    break;
+
+                if (used_.compare_exchange_weak(used, offset + size, std::memory_order_relaxed))
+                    return buffer_ + offset;
+            }
+
+            // full, the heap takes over until the arena grows.
+            overflow_count_.fetch_add(1, std::memory_order_relaxed);
+            overflow_size_.fetch_add(size + alignment, std::memory_order_relaxed);
+            return ::operator new(size);
+        }
+
+        /**
+         * \brief Give back memory from Allocate, only memory from the heap is actually freed.
+         */
+        void Deallocate(void* memory)
+        {
+            if (!Owns(memory))
+                ::operator delete(memory);
+        }
+
+        bool Owns(const void* memory) const
+        {
+            const char* address = static_cast<const char*>(memory);
+            return (address >= buffer_ && address < buffer_ + capacity_);
+        }
+
+        /**
+         * \brief Empty the arena, every allocation from it becomes invalid.
+         * Called once the frame is done with them, while nothing is allocating.
+         */
+        void Reset()
+        {
+            std::size_t used = used_.load(std::memory_order_relaxed);
+            std::size_t overflowSize = overflow_size_.load(std::memory_order_relaxed);
+            if (used + overflowSize > peak_used_)
+                peak_used_ = used + overflowSize;
+
+            // the frame didn't fit, make room for the next ones.
+            if (overflowSize > 0)
+                Grow(peak_used_ + peak_used_ / 2);
+
+            used_.store(0, std::memory_order_relaxed);
+            overflow_count_.store(0, std::memory_order_relaxed);
+            overflow_size_.store(0, std::memory_order_relaxed);
+        }
+
+        std::size_t GetCapacity() const
+        {
+            return capacity_;
+        }
+
+        /**
+         * \brief Get bytes allocated since the last reset, heap allocations excluded.
+         */
+        std::size_t GetUsed() const
+        {
+            return used_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * \brief Get most bytes a frame has needed, heap allocations included.
+         */
+        std::size_t GetPeakUsed() const
+        {
+            return peak_used_;
+        }
+
+        /**
+         * \brief Get number of allocations which went to the heap since the last reset, 0 in a steady frame.
+         */
+        unsigned int GetOverflowCount() const
+        {
+            return overflow_count_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        char* buffer_;
+        std::size_t capacity_; // in bytes.
+        std::atomic<std::size_t> used_; // offset of the free memory in buffer_.
+        std::size_t peak_used_;
+        std::atomic<unsigned int> overflow_count_;
+        std::atomic<std::size_t> overflow_size_; // bytes allocated from the heap since the last reset.
+
+        /**
+         * \brief Replace the buffer by a bigger one, only while the arena is empty.
+         */
+        void Grow(std::size_t capacity)
+        {
+            if (capacity <= capacity_)
+                return;
+
+            ::operator delete(buffer_);
+            buffer_ = static_cast<char*>(::operator new(capacity));
+            capacity_ = capacity;
+        }
+    };
+
+    /**
+     * \brief Standard allocator taking its memory from a frame arena, for containers emptied within the frame.
+     */
+    template <typename T>
+    class FrameAllocator
+    {
+    public:
+        typedef T value_type;
+
+        explicit FrameAllocator(FrameArena* arena) : arena_(arena)
+        {
+        }
+
+        template <typename U>
+        FrameAllocator(const FrameAllocator<U>& other) : arena_(other.GetArena())
+        {
+        }
+
+        T* allocate(std::size_t count)
+        {
+            return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* memory, std::size_t)
+        {
+            arena_->Deallocate(memory);
+        }
+
+        FrameArena* GetArena() const
+        {
+            return arena_;
+        }
+
+        template <typename U>
+        bool operator==(const FrameAllocator<U>& other) const
+        {
+            return arena_ == other.GetArena();
+        }
+
+        template <typename U>
+        bool operator!=(const FrameAllocator<U>& other) const
+        {
+            return arena_ != other.GetArena();
+        }
+
+    private:
+        FrameArena* arena_;
+    };
+
+    /**
+     * \brief Vector in a frame arena, it must be destroyed before the arena is reset.
+     */
+    template <typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
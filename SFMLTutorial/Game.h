@@ -16,12 +16,17 @@ namespace SFMLTutorial
     public:
         Game() : window_("Game", sf::Vector2u(800, 600)), /* world_(sf::Vector2u(800, 600)),
                   textbox_(5, 14, 350, sf::Vector2f(16.0f, 16.0f)), snake_(world_.GetGridSize(), &textbox_),*/
+                 job_system_(JobSystem::GetDefaultWorkerCount()), frame_arena_(FRAME_ARENA_SIZE),
                  state_mgr_(&context_)
         {
             // textbox_.Add("Seeded random number generator with: " + std::to_string(time(nullptr)));
             // window_.GetEventManager().AddCallback("Move", &Game::MoveSprite, this);
             context_.window_ = &window_;
             context_.event_manager_ = &window_.GetEventManager();
+            context_.job_system_ = &job_system_;
+            context_.frame_arena_ = &frame_arena_;
+            if (USE_INPUT_THREAD)
+                window_.GetEventManager().StartInputThread();
             state_mgr_.SwitchTo(StateType::INTRO);
         }
 
@@ -46,8 +51,22 @@ namespace SFMLTutorial
         {
             window_.Update();
 
-            // mush_.Update(window_.GetWindowSize().x, window_.GetWindowSize().y, time_elapsed_.asSeconds());
-            state_mgr_.Update(time_elapsed_);
+            // run the simulation in fixed steps whatever the frame time, a slow frame is caught up
+            // with up to MAX_STEPS_PER_FRAME steps, the time left over is dropped.
+            const sf::Time timeStep = sf::seconds(TIME_STEP);
+            time_accumulator_ += time_elapsed_;
+            unsigned int steps = 0;
+            while (time_accumulator_ >= timeStep && steps < MAX_STEPS_PER_FRAME)
+            {
+                // mush_.Update(window_.GetWindowSize().x, window_.GetWindowSize().y, time_elapsed_.asSeconds());
+                state_mgr_.Update(timeStep);
+                time_accumulator_ -= timeStep;
+                ++steps;
+            }
+            time_accumulator_ %= timeStep;
+
+            // how far rendering is between the previous and the current step.
+            context_.interpolation_ = time_accumulator_.asSeconds() / TIME_STEP;
 
             /*float timeStep = 1.0f / snake_.GetSpeed();
             if (time_elapsed_.asSeconds() >= timeStep)
@@ -67,6 +86,7 @@ namespace SFMLTutorial
         void LateUpdate()
         {
             state_mgr_.ProcessRequests();
+            frame_arena_.Reset(); // nothing of the frame is alive any more.
             RestartClock();
         }
 
@@ -107,12 +127,18 @@ namespace SFMLTutorial
         // Mushroom mush_;
         sf::Clock clock_;
         sf::Time time_elapsed_;
+        sf::Time time_accumulator_; // time not simulated yet, less than a step after Update.
         // World world_;
         // Textbox textbox_;
         // Snake snake_;
+        JobSystem job_system_; // outlives the states.
+        FrameArena frame_arena_;
         SharedContext context_;
         StateManager state_mgr_;
-        // static constexpr float FPS = 1 / 60.0f; // 60 frame per second.
+        static constexpr float TIME_STEP = 1 / 60.0f; // simulation step, 60 updates per second.
+        static constexpr unsigned int MAX_STEPS_PER_FRAME = 5;
+        static constexpr bool USE_INPUT_THREAD = false; // sample input many times per frame, on a thread.
+        static constexpr std::size_t FRAME_ARENA_SIZE = 1024 * 1024; // in bytes, grows if a frame needs more.
 
         /*void MoveSprite(EventDetails* details)
         {
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "pch.h"
+#include "InputState.h"
+#include "SpscRing.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief State of the devices from a time on, until the next sample.
+     */
+    struct InputSample
+    {
+        InputState state_;
+        sf::Time time_; // on the clock given to the sampler.
+    };
+
+    /**
+     * \brief Thread polling keys and buttons many times per frame, it pushes a timestamped sample
+     * each time they change, for the main thread to drain once per frame (see EventManager::Update).
+     * Presses shorter than a frame aren't missed and their order and time within the frame are kept.
+     * Only devices are sampled (sf::Keyboard, sf::Mouse), window events must be polled by the thread of the window.
+     */
+    class InputSampler
+    {
+    public:
+        static constexpr std::size_t RING_CAPACITY = 256; // changes not drained yet, further ones are delayed.
+
+        /**
+         * @param clock: time base of the samples, it must outlive the sampler.
+         * @param interval: time between two samples, the OS may sleep longer (1 ms timer resolution at best).
+         */
+        InputSampler(const sf::Clock* clock, sf::Time interval) : clock_(clock), interval_(interval),
+                                                                  inputs_version_(0), is_stopping_(false)
+        {
+            thread_ = std::thread(&InputSampler::SampleLoop, this);
+        }
+
+        ~InputSampler()
+        {
+            is_stopping_.store(true, std::memory_order_relaxed);
+            thread_.join();
+        }
+
+        InputSampler(const InputSampler&) = delete;
+        InputSampler& operator=(const InputSampler&) = delete;
+
+        /**
+         * \brief Set the keys and buttons to sample (e.g. every one bound to an action).
+         */
+        void SetInputs(const InputState& inputs)
+        {
+            std::lock_guard<std::mutex> lock(inputs_mutex_);
+            inputs_ = inputs;
+            inputs_version_.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+         * \brief Take the oldest sample not drained yet, only called by one thread.
+         * @return false: if every sample has been drained.
+         */
+        bool Pop(InputSample& sample)
+        {
+            return samples_.Pop(sample);
+        }
+
+    private:
+        const sf::Clock* clock_;
+        sf::Time interval_;
+        std::thread thread_;
+        SpscRing<InputSample, RING_CAPACITY> samples_;
+        std::mutex inputs_mutex_; // only taken when the inputs change.
+        InputState inputs_;
+        std::atomic<unsigned int> inputs_version_;
+        std::atomic<bool> is_stopping_;
+
+        void SampleLoop()
+        {
+            InputState inputs;
+            unsigned int inputsVersion = 0;
+            InputState lastState; // last state pushed.
+            while (!is_stopping_.load(std::memory_order_relaxed))
+            {
+                if (inputs_version_.load(std::memory_order_acquire) != inputsVersion)
+                {
+                    std::lock_guard<std::mutex> lock(inputs_mutex_);
+                    inputs = inputs_;
+                    inputsVersion = inputs_version_.load(std::memory_order_relaxed);
+                }
+
+                // a sample is only pushed on change, if the ring is full it's pushed once there's room.
+                InputState state = InputState::Poll(inputs);
+                if (state != lastState && samples_.Push({state, clock_->getElapsedTime()}))
+                    lastState = state;
+
+                // sf::sleep raises the Windows timer resolution to 1 ms while sleeping, sleep_for may sleep 15.6 ms.
+                sf::sleep(interval_);
+            }
+        }
+    };
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "pch.h"
+#include <cstdint>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Set of keyboard keys and mouse buttons, one bit each: what's held during a frame,
+     * or what a binding requires to be held (a chord is held when the state contains it).
+     */
+    class InputState
+    {
+    public:
+        static constexpr unsigned int KEY_COUNT = sf::Keyboard::KeyCount;
+        static constexpr unsigned int BUTTON_COUNT = sf::Mouse::ButtonCount;
+        static constexpr unsigned int INPUT_COUNT = KEY_COUNT + BUTTON_COUNT; // keys first, then buttons.
+        static constexpr unsigned int WORD_COUNT = (INPUT_COUNT + 63) / 64;
+
+        InputState() : words_()
+        {
+        }
+
+        /**
+         * @return false: if the key code doesn't exist (e.g. sf::Keyboard::Unknown).
+         */
+        bool SetKey(int key, bool isPressed)
+        {
+            if (key < 0 || key >= static_cast<int>(KEY_COUNT))
+                return false;
+
+            Set(key, isPressed);
+            return true;
+        }
+
+        /**
+         * @return false: if the button code doesn't exist.
+         */
+        bool SetButton(int button, bool isPressed)
+        {
+            if (button < 0 || button >= static_cast<int>(BUTTON_COUNT))
+                return false;
+
+            Set(KEY_COUNT + button, isPressed);
+            return true;
+        }
+
+        bool IsKeyPressed(sf::Keyboard::Key key) const
+        {
+            return (key >= 0 && key < static_cast<int>(KEY_COUNT) && IsSet(key));
+        }
+
+        bool IsButtonPressed(sf::Mouse::Button button) const
+        {
+            return (button >= 0 && button < static_cast<int>(BUTTON_COUNT) && IsSet(KEY_COUNT + button));
+        }
+
+        /**
+         * \brief Check whether every key and button of another set is in this one.
+         */
+        bool Contains(const InputState& other) const
+        {
+            for (unsigned int i = 0; i < WORD_COUNT; i++)
+            {
+                if ((words_[i] & other.words_[i]) != other.words_[i])
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+         * \brief Add the keys and buttons of another set to this one.
+         */
+        void Merge(const InputState& other)
+        {
+            for (unsigned int i = 0; i < WORD_COUNT; i++)
+            {
+                words_[i] |= other.words_[i];
+            }
+        }
+
+        bool operator==(const InputState& other) const
+        {
+            for (unsigned int i = 0; i < WORD_COUNT; i++)
+            {
+                if (words_[i] != other.words_[i])
+                    return false;
+            }
+            return true;
+        }
+
+        bool operator!=(const InputState& other) const
+        {
+            return !(*this == other);
+        }
+
+        void Clear()
+        {
+            for (auto& word : words_)
+            {
+                word = 0;
+            }
+        }
+
+        bool IsEmpty() const
+        {
+            for (auto word : words_)
+            {
+                if (word != 0)
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+         * \brief Ask the devices which of some keys and buttons are held, a query per key or button of the set.
+         * @param inputs: keys and buttons to query (e.g. every one bound to an action).
+         */
+        static InputState Poll(const InputState& inputs)
+        {
+            InputState state;
+            for (unsigned int i = 0; i < WORD_COUNT; i++)
+            {
+                std::uint64_t word = inputs.words_[i];
+                for (unsigned int bit = 0; word != 0; bit++, word >>= 1)
+                {
+                    if (!(word & 1))
+                        continue;
+
+                    unsigned int index = i * 64 + bit;
+                    bool isPressed = (index < KEY_COUNT
+                                          ? sf::Keyboard::isKeyPressed(sf::Keyboard::Key(index))
+                                          : sf::Mouse::isButtonPressed(sf::Mouse::Button(index - KEY_COUNT)));
+                    state.Set(index, isPressed);
+                }
+            }
+            return state;
+        }
+
+    private:
+        std::uint64_t words_[WORD_COUNT];
+
+        void Set(unsigned int index, bool isPressed)
+        {
+            std::uint64_t bit = static_cast<std::uint64_t>(1) << (index % 64);
+            if (isPressed)
+                words_[index / 64] |= bit;
+            else
+                words_[index / 64] &= ~bit;
+        }
+
+        bool IsSet(unsigned int index) const
+        {
+            return (words_[index / 64] >> (index % 64)) & 1;
+        }
+    };
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+
+namespace SFMLTutorial
+{
+    class JobSystem;
+
+    /**
+     * \brief Piece of work run by the job system, see JobSystem::CreateJob.
+     */
+    class Job
+    {
+    public:
+        bool IsFinished() const
+        {
+            return unfinished_.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        friend class JobSystem;
+
+        std::function<void()> task_;
+        Job* parent_ = nullptr; // finished once its task and all its children are.
+        std::atomic<int> unfinished_{0}; // task of the job and children not finished yet.
+    };
+
+    /**
+     * \brief Double-ended queue of jobs owned by a thread (Chase-Lev): the owner pushes and pops at the bottom,
+     * other threads steal at the top, without lock.
+     */
+    class JobQueue
+    {
+    public:
+        static constexpr unsigned int CAPACITY = 4096; // power of 2.
+
+        JobQueue() : top_(0), bottom_(0)
+        {
+        }
+
+        /**
+         * \brief Add a job, only called by the owner.
+         * @return false: if the queue is full.
+         */
+        bool Push(Job* job)
+        {
+            long long bottom = bottom_.load(std::memory_order_relaxed);
+            long long top = top_.load(std::memory_order_acquire);
+            if (bottom - top >= static_cast<long long>(CAPACITY))
+                return false;
+
+            jobs_[bottom & MASK].store(job, std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * \brief Take the last job pushed, only called by the owner.
+         * @return nullptr: if the queue is empty.
+         */
+        Job* Pop()
+        {
+            long long bottom = bottom_.load(std::memory_order_relaxed) - 1;
+            bottom_.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            long long top = top_.load(std::memory_order_relaxed);
+
+            if (top > bottom) // empty.
+            {
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            Job* job = jobs_[bottom & MASK].load(std::memory_order_relaxed);
+            if (top == bottom) // last job, a thief may be taking it.
+            {
+                if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    job = nullptr;
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return job;
+        }
+
+        /**
+         * \brief Take the first job pushed, called by the other threads.
+         * @return nullptr: if the queue is empty or another thread took the job first.
+         */
+        Job* Steal()
+        {
+            long long top = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            long long bottom = bottom_.load(std::memory_order_acquire);
+            if (top >= bottom)
+                return nullptr;
+
+            Job* job = jobs_[top & MASK].load(std::memory_order_relaxed);
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return job;
+        }
+
+    private:
+        static constexpr long long MASK = CAPACITY - 1;
+
+        std::atomic<Job*> jobs_[CAPACITY];
+        std::atomic<long long> top_; // next job to steal.
+        std::atomic<long long> bottom_; // next free slot.
+    };
+
+    /**
+     * \brief Work-stealing scheduler: each thread runs the jobs of its own queue, last pushed first,
+     * and steals the oldest jobs of the other queues when its own is empty. Jobs may create child jobs,
+     * a job is finished once its children are, so waiting on a parent waits on the whole tree.
+     * Jobs are created and run from the thread owning the job system or from jobs.
+     */
+    class JobSystem
+    {
+    public:
+        static constexpr unsigned int MAX_JOBS_PER_THREAD = 4096; // jobs of a thread are recycled past this.
+
+        /**
+         * @param workerCount: threads besides the owning one, 0: jobs run when they are waited on.
+         */
+        explicit JobSystem(unsigned int workerCount) : threads_(workerCount + 1), queued_(0), sleeping_(0),
+                                                       is_stopping_(false)
+        {
+            GetThreadIndex() = 0;
+            for (unsigned int i = 1; i <= workerCount; i++)
+            {
+                workers_.emplace_back(&JobSystem::WorkerLoop, this, i);
+            }
+        }
+
+        ~JobSystem()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                is_stopping_ = true;
+            }
+            wake_.notify_all();
+
+            for (auto& worker : workers_)
+            {
+                worker.join();
+            }
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /**
+         * \brief Get number of worker threads for this machine, the owning thread runs jobs too.
+         */
+        static unsigned int GetDefaultWorkerCount()
+        {
+            unsigned int threadCount = std::thread::hardware_concurrency(); // 0: unknown.
+            return (threadCount > 1 ? threadCount - 1 : 0);
+        }
+
+        /**
+         * \brief Get number of threads running jobs (workers and the owning thread).
+         */
+        unsigned int GetThreadCount() const
+        {
+            return static_cast<unsigned int>(threads_.size());
+        }
+
+        /**
+         * \brief Create a job, it doesn't run until it's given to Run.
+         * The job is valid until MAX_JOBS_PER_THREAD other jobs are created by this thread.
+         */
+        Job* CreateJob(const std::function<void()>& task)
+        {
+            return CreateChildJob(nullptr, task);
+        }
+
+        /**
+         * \brief Create a job the parent waits for: the parent isn't finished until the child is.
+         * At most MAX_JOBS_PER_THREAD jobs of a thread may be unfinished at a time, their slots are reused in turn.
+         * @param parent: job not finished yet, nullptr: no parent.
+         */
+        Job* CreateChildJob(Job* parent, const std::function<void()>& task)
+        {
+            ThreadData& thread = threads_[GetThreadIndex()];
+            Job* job = &thread.jobs_[thread.next_job_++ % MAX_JOBS_PER_THREAD];
+            assert(job->IsFinished() && "too many unfinished jobs on this thread");
+            job->task_ = task;
+            job->parent_ = parent;
+            job->unfinished_.store(1, std::memory_order_relaxed);
+            if (parent)
+                parent->unfinished_.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+
+        /**
+         * \brief Queue a job on this thread, idle threads steal it.
+         */
+        void Run(Job* job)
+        {
+            ThreadData& thread = threads_[GetThreadIndex()];
+            if (!thread.queue_.Push(job))
+            {
+                Execute(job); // queue full, no need to queue it.
+                return;
+            }
+
+            queued_.fetch_add(1);
+            if (sleeping_.load() > 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                wake_.notify_one();
+            }
+        }
+
+        /**
+         * \brief Run jobs until a job is finished, so the waiting thread isn't idle.
+         */
+        void Wait(const Job* job)
+        {
+            while (!job->IsFinished())
+            {
+                Job* next = GetJob();
+                if (next)
+                    Execute(next);
+                else
+                    std::this_thread::yield();
+            }
+        }
+
+        /**
+         * \brief Run a loop over [0, count) split into ranges, return once every range is done.
+         * Ranges are contiguous and in order, so results gathered per range and merged by range index
+         * come out in the same order as a serial loop, whatever the number of threads.
+         * @param minRangeSize: fewer iterations aren't worth a job (e.g. cheap iterations).
+         * @param function: void(std::size_t begin, std::size_t end, unsigned int range),
+         * range: index of the range in [0, GetThreadCount()), ranges with a lower index cover lower iterations.
+         */
+        template <typename Function>
+        void ParallelFor(std::size_t count, std::size_t minRangeSize, Function function)
+        {
+            if (count == 0)
+                return;
+
+            minRangeSize = std::max<std::size_t>(minRangeSize, 1);
+            std::size_t rangeCount = std::min<std::size_t>(GetThreadCount(), (count + minRangeSize - 1) / minRangeSize);
+            if (rangeCount <= 1)
+            {
+                function(0, count, 0);
+                return;
+            }
+
+            struct Loop
+            {
+                Function* function_;
+                std::size_t count_;
+                std::size_t range_count_;
+            } loop = {&function, count, rangeCount};
+
+            // the first range is run by this thread, small captures so std::function doesn't allocate.
+            Job* root = CreateJob([&loop]
+            {
+                (*loop.function_)(0, loop.count_ / loop.range_count_, 0);
+            });
+            for (std::size_t range = 1; range < rangeCount; range++)
+            {
+                Run(CreateChildJob(root, [&loop, range]
+                {
+                    (*loop.function_)(loop.count_ * range / loop.range_count_,
+                                      loop.count_ * (range + 1) / loop.range_count_, static_cast<unsigned int>(range));
+                }));
+            }
+
+            Execute(root);
+            Wait(root);
+        }
+
+    private:
+        /**
+         * \brief Queue and jobs of a thread, a thread only creates jobs in its own.
+         */
+        struct ThreadData
+        {
+            JobQueue queue_;
+            std::vector<Job> jobs_ = std::vector<Job>(MAX_JOBS_PER_THREAD);
+            unsigned int next_job_ = 0;
+        };
+
+        std::vector<ThreadData> threads_; // index 0: owning thread.
+        std::vector<std::thread> workers_;
+        std::atomic<int> queued_; // jobs in the queues.
+        std::atomic<int> sleeping_; // workers waiting for jobs.
+        std::mutex mutex_;
+        std::condition_variable wake_; // jobs are queued or the job system is stopping.
+        bool is_stopping_;
+
+        /**
+         * \brief Index of the calling thread in threads_.
+         */
+        static unsigned int& GetThreadIndex()
+        {
+            thread_local unsigned int index = 0;
+            return index;
+        }
+
+        /**
+         * \brief Take a job of this thread, or steal one from another thread.
+         * @return nullptr: if every queue is empty.
+         */
+        Job* GetJob()
+        {
+            const unsigned int index = GetThreadIndex();
+            Job* job = threads_[index].queue_.Pop();
+            for (unsigned int i = 1; !job && i < threads_.size(); i++)
+            {
+                job = threads_[(index + i) % threads_.size()].queue_.Steal();
+            }
+
+            if (job)
+                queued_.fetch_sub(1);
+            return job;
+        }
+
+        void Execute(Job* job)
+        {
+            if (job->task_)
+                job->task_();
+            Finish(job);
+        }
+
+        /**
+         * \brief Mark the task of a job (or a child) as done, the parent is told once the job is finished.
+         */
+        static void Finish(Job* job)
+        {
+            while (job && job->unfinished_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                job = job->parent_;
+            }
+        }
+
+        void WorkerLoop(unsigned int index)
+        {
+            GetThreadIndex() = index;
+            for (;;)
+            {
+                Job* job = GetJob();
+                if (job)
+                {
+                    Execute(job);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(mutex_);
+                ++sleeping_;
+                wake_.wait(lock, [this]
+                {
+                    return is_stopping_ || queued_.load() > 0;
+                });
+                --sleeping_;
+
+                if (is_stopping_)
+                    return;
+            }
+        }
+    };
+}
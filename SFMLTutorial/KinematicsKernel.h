@@ -0,0 +1,298 @@
+#pragma once
+
+#include "pch.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SFMLTUTORIAL_KINEMATICS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SFMLTUTORIAL_KINEMATICS_SSE2
+#endif
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Kinematics of a set of bodies, one packed array per field (see KinematicsComponent).
+     */
+    struct KinematicsArrays
+    {
+        std::vector<float> velocity_x_;
+        std::vector<float> velocity_y_;
+        std::vector<float> acceleration_x_; // cleared after every update.
+        std::vector<float> acceleration_y_;
+        std::vector<float> max_velocity_x_; // 0: no limit on this axis.
+        std::vector<float> max_velocity_y_;
+        std::vector<float> friction_x_; // velocity lost per second.
+        std::vector<float> friction_y_;
+        std::vector<float> gravity_scale_;
+
+        std::size_t GetCount() const
+        {
+            return velocity_x_.size();
+        }
+
+        void Add(const sf::Vector2f& velocity, const sf::Vector2f& acceleration, const sf::Vector2f& maxVelocity,
+                 const sf::Vector2f& friction, float gravityScale)
+        {
+            velocity_x_.emplace_back(velocity.x);
+            velocity_y_.emplace_back(velocity.y);
+            acceleration_x_.emplace_back(acceleration.x);
+            acceleration_y_.emplace_back(acceleration.y);
+            max_velocity_x_.emplace_back(maxVelocity.x);
+            max_velocity_y_.emplace_back(maxVelocity.y);
+            friction_x_.emplace_back(friction.x);
+            friction_y_.emplace_back(friction.y);
+            gravity_scale_.emplace_back(gravityScale);
+        }
+
+        /**
+         * \brief Copy a body over another one.
+         */
+        void Copy(std::size_t to, std::size_t from)
+        {
+            velocity_x_[to] = velocity_x_[from];
+            velocity_y_[to] = velocity_y_[from];
+            acceleration_x_[to] = acceleration_x_[from];
+            acceleration_y_[to] = acceleration_y_[from];
+            max_velocity_x_[to] = max_velocity_x_[from];
+            max_velocity_y_[to] = max_velocity_y_[from];
+            friction_x_[to] = friction_x_[from];
+            friction_y_[to] = friction_y_[from];
+            gravity_scale_[to] = gravity_scale_[from];
+        }
+
+        void RemoveLast()
+        {
+            velocity_x_.pop_back();
+            velocity_y_.pop_back();
+            acceleration_x_.pop_back();
+            acceleration_y_.pop_back();
+            max_velocity_x_.pop_back();
+            max_velocity_y_.pop_back();
+            friction_x_.pop_back();
+            friction_y_.pop_back();
+            gravity_scale_.pop_back();
+        }
+
+        void Clear()
+        {
+            velocity_x_.clear();
+            velocity_y_.clear();
+            acceleration_x_.clear();
+            acceleration_y_.clear();
+            max_velocity_x_.clear();
+            max_velocity_y_.clear();
+            friction_x_.clear();
+            friction_y_.clear();
+            gravity_scale_.clear();
+        }
+    };
+
+    /**
+     * \brief Integrate the kinematics of many bodies in one pass: gravity, acceleration, velocity clamping,
+     * friction, then move the positions. Several bodies are processed at a time with SSE2 (or AVX2 when the build
+     * enables it), the results are the same as the scalar path, which handles the remaining bodies.
+     * Floating point contraction (FMA) must stay disabled for the paths to match (MSVC /fp:precise).
+     */
+    class KinematicsKernel
+    {
+    public:
+        static_assert(sizeof(sf::Vector2f) == 2 * sizeof(float), "positions are read as packed x y pairs");
+
+        /**
+         * @param positions: one per body, moved by velocity * deltaTime.
+         */
+        static void Integrate(KinematicsArrays& bodies, sf::Vector2f* positions, float gravity, float deltaTime)
+        {
+            const std::size_t count = bodies.GetCount();
+            std::size_t i = 0;
+#if defined(SFMLTUTORIAL_KINEMATICS_AVX2)
+            i = IntegrateAvx2(bodies, positions, gravity, deltaTime);
+#elif defined(SFMLTUTORIAL_KINEMATICS_SSE2)
+            i = IntegrateSse2(bodies, positions, gravity, deltaTime);
+#endif
+            for (; i < count; i++)
+            {
+                IntegrateScalar(bodies, positions, i, gravity, deltaTime);
+            }
+        }
+
+        /**
+         * \brief Integrate a single body, in the order of EntityBase::Update but with the rules of simple entities
+         * (see KinematicsComponent).
+         */
+        static void IntegrateScalar(KinematicsArrays& bodies, sf::Vector2f* positions, std::size_t i, float gravity,
+                                    float deltaTime)
+        {
+            float velocityX = bodies.velocity_x_[i] + bodies.acceleration_x_[i] * deltaTime;
+            float velocityY = bodies.velocity_y_[i] + (bodies.acceleration_y_[i] + gravity * bodies.gravity_scale_[i])
+                * deltaTime;
+            bodies.acceleration_x_[i] = 0.0f;
+            bodies.acceleration_y_[i] = 0.0f;
+
+            if (bodies.max_velocity_x_[i] > 0)
+                velocityX = std::max(-bodies.max_velocity_x_[i], std::min(velocityX, bodies.max_velocity_x_[i]));
+            if (bodies.max_velocity_y_[i] > 0)
+                velocityY = std::max(-bodies.max_velocity_y_[i], std::min(velocityY, bodies.max_velocity_y_[i]));
+
+            velocityX = ApplyFriction(velocityX, bodies.friction_x_[i] * deltaTime);
+            velocityY = ApplyFriction(velocityY, bodies.friction_y_[i] * deltaTime);
+
+            bodies.velocity_x_[i] = velocityX;
+            bodies.velocity_y_[i] = velocityY;
+            positions[i].x += velocityX * deltaTime;
+            positions[i].y += velocityY * deltaTime;
+        }
+
+    private:
+        /**
+         * \brief Slow a velocity down by an amount, without changing its direction (see EntityBase::ApplyFriction).
+         */
+        static float ApplyFriction(float velocity, float friction)
+        {
+            if (fabs(velocity) - fabs(friction) < 0)
+                return 0.0f;
+            return (velocity < 0 ? velocity + fabs(friction) : velocity - fabs(friction));
+        }
+
+#if defined(SFMLTUTORIAL_KINEMATICS_SSE2)
+        /**
+         * \brief Clamp to [-max, max] where max > 0, like IntegrateScalar.
+         */
+        static __m128 Clamp(__m128 velocity, __m128 max)
+        {
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+            // same operand order as std::min / std::max, so NaNs come out the same.
+            __m128 clamped = _mm_max_ps(_mm_min_ps(max, velocity), _mm_xor_ps(max, signMask));
+            __m128 isLimited = _mm_cmpgt_ps(max, _mm_setzero_ps());
+            return _mm_or_ps(_mm_and_ps(isLimited, clamped), _mm_andnot_ps(isLimited, velocity));
+        }
+
+        /**
+         * \brief Branchless ApplyFriction: v - |f| (v + |f| when v < 0), 0 when |v| < |f|.
+         */
+        static __m128 ApplyFriction(__m128 velocity, __m128 friction)
+        {
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+            __m128 absFriction = _mm_andnot_ps(signMask, friction);
+            __m128 isNegative = _mm_cmplt_ps(velocity, _mm_setzero_ps());
+            __m128 slowed = _mm_sub_ps(velocity, _mm_xor_ps(absFriction, _mm_and_ps(isNegative, signMask)));
+            __m128 isStopped = _mm_cmplt_ps(_mm_sub_ps(_mm_andnot_ps(signMask, velocity), absFriction),
+                                            _mm_setzero_ps());
+            return _mm_andnot_ps(isStopped, slowed);
+        }
+
+        /**
+         * @return number of bodies integrated, the first ones.
+         */
+        static std::size_t IntegrateSse2(KinematicsArrays& bodies, sf::Vector2f* positions, float gravity,
+                                         float deltaTime)
+        {
+            const std::size_t count = bodies.GetCount() & ~std::size_t(3);
+            const __m128 gravityLanes = _mm_set1_ps(gravity);
+            const __m128 deltaLanes = _mm_set1_ps(deltaTime);
+            float* position = &positions[0].x; // x0 y0 x1 y1...
+
+            for (std::size_t i = 0; i < count; i += 4)
+            {
+                __m128 velocityX = _mm_add_ps(_mm_loadu_ps(&bodies.velocity_x_[i]),
+                                              _mm_mul_ps(_mm_loadu_ps(&bodies.acceleration_x_[i]), deltaLanes));
+                __m128 accelerationY = _mm_add_ps(_mm_loadu_ps(&bodies.acceleration_y_[i]),
+                                                  _mm_mul_ps(gravityLanes, _mm_loadu_ps(&bodies.gravity_scale_[i])));
+                __m128 velocityY = _mm_add_ps(_mm_loadu_ps(&bodies.velocity_y_[i]),
+                                              _mm_mul_ps(accelerationY, deltaLanes));
+                _mm_storeu_ps(&bodies.acceleration_x_[i], _mm_setzero_ps());
+                _mm_storeu_ps(&bodies.acceleration_y_[i], _mm_setzero_ps());
+
+                velocityX = Clamp(velocityX, _mm_loadu_ps(&bodies.max_velocity_x_[i]));
+                velocityY = Clamp(velocityY, _mm_loadu_ps(&bodies.max_velocity_y_[i]));
+
+                velocityX = ApplyFriction(velocityX, _mm_mul_ps(_mm_loadu_ps(&bodies.friction_x_[i]), deltaLanes));
+                velocityY = ApplyFriction(velocityY, _mm_mul_ps(_mm_loadu_ps(&bodies.friction_y_[i]), deltaLanes));
+
+                _mm_storeu_ps(&bodies.velocity_x_[i], velocityX);
+                _mm_storeu_ps(&bodies.velocity_y_[i], velocityY);
+
+                // interleave the moves to add them to the x y pairs of the positions.
+                __m128 moveX = _mm_mul_ps(velocityX, deltaLanes);
+                __m128 moveY = _mm_mul_ps(velocityY, deltaLanes);
+                float* pair = position + i * 2;
+                _mm_storeu_ps(pair, _mm_add_ps(_mm_loadu_ps(pair), _mm_unpacklo_ps(moveX, moveY)));
+                _mm_storeu_ps(pair + 4, _mm_add_ps(_mm_loadu_ps(pair + 4), _mm_unpackhi_ps(moveX, moveY)));
+            }
+
+            return count;
+        }
+#endif
+
+#if defined(SFMLTUTORIAL_KINEMATICS_AVX2)
+        static __m256 Clamp(__m256 velocity, __m256 max)
+        {
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+            __m256 clamped = _mm256_max_ps(_mm256_min_ps(max, velocity), _mm256_xor_ps(max, signMask));
+            __m256 isLimited = _mm256_cmp_ps(max, _mm256_setzero_ps(), _CMP_GT_OQ);
+            return _mm256_blendv_ps(velocity, clamped, isLimited);
+        }
+
+        static __m256 ApplyFriction(__m256 velocity, __m256 friction)
+        {
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+            __m256 absFriction = _mm256_andnot_ps(signMask, friction);
+            __m256 isNegative = _mm256_cmp_ps(velocity, _mm256_setzero_ps(), _CMP_LT_OQ);
+            __m256 slowed = _mm256_sub_ps(velocity, _mm256_xor_ps(absFriction, _mm256_and_ps(isNegative, signMask)));
+            __m256 isStopped = _mm256_cmp_ps(_mm256_sub_ps(_mm256_andnot_ps(signMask, velocity), absFriction),
+                                             _mm256_setzero_ps(), _CMP_LT_OQ);
+            return _mm256_andnot_ps(isStopped, slowed);
+        }
+
+        static std::size_t IntegrateAvx2(KinematicsArrays& bodies, sf::Vector2f* positions, float gravity,
+                                         float deltaTime)
+        {
+            const std::size_t count = bodies.GetCount() & ~std::size_t(7);
+            const __m256 gravityLanes = _mm256_set1_ps(gravity);
+            const __m256 deltaLanes = _mm256_set1_ps(deltaTime);
+            float* position = &positions[0].x;
+
+            for (std::size_t i = 0; i < count; i += 8)
+            {
+                __m256 velocityX = _mm256_add_ps(_mm256_loadu_ps(&bodies.velocity_x_[i]),
+                                                 _mm256_mul_ps(_mm256_loadu_ps(&bodies.acceleration_x_[i]),
+                                                               deltaLanes));
+                __m256 accelerationY = _mm256_add_ps(_mm256_loadu_ps(&bodies.acceleration_y_[i]),
+                                                     _mm256_mul_ps(gravityLanes,
+                                                                   _mm256_loadu_ps(&bodies.gravity_scale_[i])));
+                __m256 velocityY = _mm256_add_ps(_mm256_loadu_ps(&bodies.velocity_y_[i]),
+                                                 _mm256_mul_ps(accelerationY, deltaLanes));
+                _mm256_storeu_ps(&bodies.acceleration_x_[i], _mm256_setzero_ps());
+                _mm256_storeu_ps(&bodies.acceleration_y_[i], _mm256_setzero_ps());
+
+                velocityX = Clamp(velocityX, _mm256_loadu_ps(&bodies.max_velocity_x_[i]));
+                velocityY = Clamp(velocityY, _mm256_loadu_ps(&bodies.max_velocity_y_[i]));
+
+                velocityX = ApplyFriction(velocityX, _mm256_mul_ps(_mm256_loadu_ps(&bodies.friction_x_[i]),
+                                                                   deltaLanes));
+                velocityY = ApplyFriction(velocityY, _mm256_mul_ps(_mm256_loadu_ps(&bodies.friction_y_[i]),
+                                                                   deltaLanes));
+
+                _mm256_storeu_ps(&bodies.velocity_x_[i], velocityX);
+                _mm256_storeu_ps(&bodies.velocity_y_[i], velocityY);
+
+                // unpack interleaves within 128-bit lanes: (0 1 | 4 5) and (2 3 | 6 7), put them back in order.
+                __m256 moveX = _mm256_mul_ps(velocityX, deltaLanes);
+                __m256 moveY = _mm256_mul_ps(velocityY, deltaLanes);
+                __m256 low = _mm256_unpacklo_ps(moveX, moveY);
+                __m256 high = _mm256_unpackhi_ps(moveX, moveY);
+                float* pair = position + i * 2;
+                _mm256_storeu_ps(pair, _mm256_add_ps(_mm256_loadu_ps(pair), _mm256_permute2f128_ps(low, high, 0x20)));
+                _mm256_storeu_ps(pair + 8, _mm256_add_ps(_mm256_loadu_ps(pair + 8),
+                                                         _mm256_permute2f128_ps(low, high, 0x31)));
+            }
+
+            return count;
+        }
+#endif
+    };
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "pch.h"
+#include <cstdint>
+#include <algorithm>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Histogram of the last WINDOW_SIZE latencies (e.g. input to display), in buckets of BUCKET_SIZE,
+     * the oldest latency leaves the histogram when a new one comes in. Nothing is allocated after construction.
+     */
+    class LatencyHistogram
+    {
+    public:
+        static constexpr unsigned int WINDOW_SIZE = 1024; // latencies kept.
+        static constexpr unsigned int BUCKET_COUNT = 512;
+        static constexpr sf::Int64 BUCKET_SIZE = 500; // in microseconds, so buckets cover 256 ms.
+
+        LatencyHistogram() : counts_(), window_(), next_(0), count_(0)
+        {
+        }
+
+        /**
+         * \brief Add a latency, longer latencies than the buckets cover go to the last one.
+         */
+        void Add(sf::Time latency)
+        {
+            sf::Int64 bucket = std::max<sf::Int64>(latency.asMicroseconds(), 0) / BUCKET_SIZE;
+            std::uint16_t index = static_cast<std::uint16_t>(std::min<sf::Int64>(bucket, BUCKET_COUNT - 1));
+
+            if (count_ == WINDOW_SIZE)
+                --(counts_[window_[next_]]); // the oldest latency is replaced.
+            else
+                ++count_;
+
+            window_[next_] = index;
+            ++(counts_[index]);
+            next_ = (next_ + 1) % WINDOW_SIZE;
+        }
+
+        /**
+         * \brief Get the latency a percentage of the latencies are within, rounded up to a bucket.
+         * @param percentile: in [0, 100] (e.g. 99 for p99).
+         * @return sf::Time::Zero: if there's no latency.
+         */
+        sf::Time GetPercentile(float percentile) const
+        {
+            if (count_ == 0)
+                return sf::Time::Zero;
+
+            // rank of the latency in the sorted window, from 1.
+            unsigned int rank = static_cast<unsigned int>(percentile / 100.0f * count_ + 0.999f);
+            rank = std::min(std::max(rank, 1u), count_);
+
+            unsigned int seen = 0;
+            for (unsigned int i = 0; i < BUCKET_COUNT; i++)
+            {
+                seen += counts_[i];
+                if (seen >= rank)
+                    return sf::microseconds((i + 1) * BUCKET_SIZE);
+            }
+            return sf::microseconds(BUCKET_COUNT * BUCKET_SIZE);
+        }
+
+        /**
+         * \brief Get number of latencies in the histogram, at most WINDOW_SIZE.
+         */
+        unsigned int GetCount() const
+        {
+            return count_;
+        }
+
+        void Clear()
+        {
+            std::fill(counts_, counts_ + BUCKET_COUNT, 0);
+            next_ = 0;
+            count_ = 0;
+        }
+
+    private:
+        unsigned int counts_[BUCKET_COUNT]; // latencies per bucket.
+        std::uint16_t window_[WINDOW_SIZE]; // bucket of each latency kept, a ring.
+        unsigned int next_; // slot of the next latency in window_.
+        unsigned int count_;
+    };
+}
@@ -4,84 +4,39 @@
 #include "TextureManager.h"
 #include "BaseState.h" // incomplete class
 #include "StateManager.h" // so need to include StateManager.h
+#include "TileInfo.h"
+#include "TileGrid.h"
+#include "MapFormat.h"
+#include "MapData.h"
+#include "MapStreamer.h"
 #include <math.h>
+#include <algorithm>
+#include <future>
 
 namespace SFMLTutorial
 {
-    enum Sheet
-    {
-        TILE_SIZE = 32,
-        SHEET_WIDTH = 256,
-        SHEET_HEIGHT = 256
-    };
-
-    typedef unsigned int TileID;
-
-    struct TileInfo
-    {
-        TileInfo(SharedContext* context, const std::string& texture = "", TileID id = 0) : id_(0), is_deadly_(false),
-                                                                                           context_(context)
-        {
-            TextureManager* textureMgr = context_->texture_mgr_;
-            if (texture_.empty())
-            {
-                id_ = id;
-                return;
-            }
-
-            if (!textureMgr->RequireResource(texture))
-                return;
-
-            texture_ = texture;
-            id_ = id;
-            sprite_.setTexture(*(textureMgr->GetResource(texture_)));
-            sf::IntRect tileBoundaries(id_ % (SHEET_WIDTH / TILE_SIZE) * TILE_SIZE,
-                                       id_ / (SHEET_HEIGHT / TILE_SIZE) * TILE_SIZE, TILE_SIZE, TILE_SIZE);
-            sprite_.setTextureRect(tileBoundaries); // crop sprite.
-        }
-
-        /**
-         * \brief Free the texture used for tile sheet.
-         */
-        ~TileInfo()
-        {
-            if (texture_.empty())
-                return;
-
-            context_->texture_mgr_->ReleaseResource(texture_);
-        }
-
-        sf::Sprite sprite_; // sprite represents the tile.
-
-        TileID id_;
-        std::string name_;
-        sf::Vector2f friction_;
-        bool is_deadly_;
-
-        SharedContext* context_;
-        std::string texture_; // texture
-    };
-
-    struct Tile
-    {
-        TileInfo* properties_;
-        bool is_warp_; // is the tile a warp? (go to next level)
-    };
-
     class Map
     {
     public:
         Map(SharedContext* context, BaseState* currentState) : default_tile_(context), max_map_size_(32, 32),
-                                                               tile_count_(0), tile_set_count_(0), map_gravity_(512.0f),
+                                                               tile_sheet_(nullptr), tile_drawn_count_(0), tile_count_(0),
+                                                               tile_set_count_(0), map_gravity_(512.0f),
                                                                is_load_next_map_(false), current_state_(currentState),
-                                                               context_(context)
+                                                               context_(context),
+                                                               streamer_(std::bind(&Map::ReadChunk, this,
+                                                                                   std::placeholders::_1),
+                                                                         std::bind(&Map::OnChunkLoaded, this,
+                                                                                   std::placeholders::_1))
         {
             context_->game_map_ = this;
+            tile_grid_.Resize(max_map_size_);
             LoadTiles("tiles.cfg");
         }
 
         ~Map()
         {
+            CancelPrefetch();
+            streamer_.Stop(); // workers read the tile set.
             PurgeMap();
             PurgeTileSet();
             context_->game_map_ = nullptr;
@@ -92,8 +47,33 @@ namespace SFMLTutorial
          */
         Tile* GetTile(unsigned int x, unsigned int y)
         {
-            auto itr = tile_map_.find(ConvertCoordinates(x, y));
-            return (itr != tile_map_.end() ? itr->second : nullptr);
+            return tile_grid_.GetTile(x, y);
+        }
+
+        /**
+         * \brief Check whether a range of tile coordinates (inclusive) has a tile of a kind (solid, deadly or warp).
+         */
+        bool AnyTile(TileMask::Layer layer, int fromX, int fromY, int toX, int toY) const
+        {
+            return tile_grid_.Any(layer, fromX, fromY, toX, toY);
+        }
+
+        /**
+         * \brief Call a function for every tile collider (merged tiles) overlapping a range of tile coordinates.
+         * @param function: void(const TileCollider&).
+         */
+        template <typename Function>
+        void ForEachTileCollider(int fromX, int fromY, int toX, int toY, Function function)
+        {
+            tile_grid_.ForEachCollider(fromX, fromY, toX, toY, function);
+        }
+
+        /**
+         * \brief Build the tile colliders which are out of date, before ForEachTileCollider is called from worker threads.
+         */
+        void BuildTileColliders()
+        {
+            tile_grid_.BuildColliders();
         }
 
         TileInfo* GetDefaultTile()
@@ -122,128 +102,12 @@ namespace SFMLTutorial
         }
 
         /**
-         * \brief Load map from a path file.
+         * \brief Load map from a path file, compiled maps (MAP_FILE_EXTENSION) use the binary loader.
+         * Once the map is loaded, the map it links to (NEXTMAP) is prefetched on a worker thread.
          */
-        void LoadMapFromConfigFile(const std::string& path)
+        void LoadMap(const std::string& path)
         {
-            std::ifstream ifs;
-            ifs.open(Utilities::GetWorkingDirectoryA() + path, std::ifstream::in);
-            if (!ifs.is_open())
-            {
-#ifdef _DEBUG
-                std::cerr << "Could not load map file: " << path << std::endl;
-#endif
-                return;
-            }
-
-            // EntityManager* entityMgr = context_->entity_mgr_;
-            std::string line;
-
-            int playerId = -1;
-            while (std::getline(ifs, line))
-            {
-                if (line[0] == '|') // ignore comment
-                    continue;
-
-                std::stringstream keyStream(line);
-                std::string type;
-                keyStream >> type;
-                if (type == "TILE")
-                {
-                    int tileId = 0;
-                    keyStream >> tileId;
-                    if (tileId < 0)
-                    {
-#ifdef _DEBUG
-                        std::cerr << "Bad tile id: " << tileId << std::endl;
-#endif
-                        continue;
-                    }
-
-                    auto itr = tile_set_.find(tileId);
-                    if (itr == tile_set_.end())
-                    {
-#ifdef _DEBUG
-                        std::cerr << "Tile id: " << tileId << "was not found in tile set." << std::endl;
-#endif
-                        continue;
-                    }
-
-                    sf::Vector2i tileCoordinates;
-                    keyStream >> tileCoordinates.x >> tileCoordinates.y;
-                    if (tileCoordinates.x > max_map_size_.x || tileCoordinates.y > max_map_size_.y)
-                        // is within boundaries of map size?
-                    {
-#ifdef _DEBUG
-                        std::cerr << "Tile is out of range: " << tileCoordinates.x << " " << tileCoordinates.y <<
-                            std::endl;
-#endif
-                        continue;
-                    }
-
-                    Tile* tile = new Tile();
-                    tile->properties_ = itr->second; // tile information
-                    if (!tile_map_.emplace(ConvertCoordinates(tileCoordinates.x, tileCoordinates.y), tile).second)
-                    {
-#ifdef _DEBUG
-                        std::cerr << "Duplicate tile: " << tileCoordinates.x << " " << tileCoordinates.y << std::endl;
-#endif
-                        delete tile;
-                        tile = nullptr;
-                        continue;
-                    }
-
-                    std::string warp;
-                    keyStream >> warp;
-
-                    tile->is_warp_ = false;
-                    if (warp == "WARP")
-                        tile->is_warp_ = true;
-                }
-                else if (type == "BACKGROUND")
-                {
-                    if (!background_texture_.empty())
-                        continue;
-
-                    keyStream >> background_texture_;
-                    TextureManager* textureMgr = context_->texture_mgr_;
-
-                    if (!textureMgr->RequireResource(background_texture_))
-                    {
-                        background_texture_.clear();
-                        continue;
-                    }
-
-                    sf::Texture* texture = textureMgr->GetResource(background_texture_);
-                    background_.setTexture(*texture);
-
-                    // scale the sprite enough to fit the view space fully.
-                    sf::Vector2f viewSize = current_state_->GetView().getSize();
-                    sf::Vector2u textureSize = texture->getSize();
-                    sf::Vector2f scaleFactors;
-                    scaleFactors.x = viewSize.x / textureSize.x;
-                    scaleFactors.y = viewSize.y / textureSize.y;
-                    background_.setScale(scaleFactors);
-                }
-                else if (type == "SIZE")
-                {
-                    keyStream >> max_map_size_.x >> max_map_size_.y;
-                }
-                else if (type == "GRAVITY")
-                {
-                    keyStream >> map_gravity_;
-                }
-                else if (type == "DEFAULT_FRICTION")
-                {
-                    keyStream >> default_tile_.friction_.x >> default_tile_.friction_.y;
-                }
-                else if (type == "NEXTMAP")
-                {
-                    keyStream >> next_map_;
-                }
-            }
-
-            ifs.close();
+            CommitMapData(ReadMapData(path, max_map_size_, map_gravity_, default_tile_.friction_, false));
         }
 
         /**
@@ -264,22 +128,42 @@ namespace SFMLTutorial
                 PurgeMap();
                 is_load_next_map_ = false;
 
-                if (!next_map_.empty())
-                    LoadMapFromConfigFile("media/maps/" + next_map_);
+                std::string nextMap = next_map_;
+                next_map_.clear();
+                if (!nextMap.empty())
+                {
+                    // use the prefetched map, read it now if it was not prefetched.
+                    std::string path = "media/maps/" + nextMap;
+                    MapData* data = TakePrefetch(path);
+                    if (!data)
+                        data = ReadMapData(path, max_map_size_, map_gravity_, default_tile_.friction_, false);
+                    CommitMapData(data);
+                }
                 else
+                {
                     current_state_->GetStateManager()->SwitchTo(StateType::GAME_OVER);
-                // simulate player beating the game.
-
-                next_map_.clear();
+                    // simulate player beating the game.
+                }
             }
 
             sf::FloatRect viewSpace = context_->window_->GetViewSpace();
             background_.setPosition(viewSpace.left, viewSpace.top); // background follows the camera.
+
+            if (streamer_.IsStreaming())
+            {
+                streamer_.Update(viewSpace);
+                // entities standing on a chunk which is not loaded wait for it.
+                context_->entity_mgr_->ParkEntities([this](const sf::Vector2f& position)
+                {
+                    return !streamer_.IsLoaded(position);
+                });
+            }
         }
 
         /**
          * \brief Draw background and tiles in view space.
-         * Anything is not currently within the view space should be left undrawn.
+         * Tiles are drawn one chunk of the tile grid at a time (one draw call per chunk),
+         * chunks which are not currently within the view space are left undrawn.
          */
         void Draw()
         {
@@ -287,57 +171,357 @@ namespace SFMLTutorial
             window.draw(background_); // draw background first.
 
             sf::FloatRect viewSpace = context_->window_->GetViewSpace();
-            sf::Vector2i tileBegin(floor(viewSpace.left / TILE_SIZE), floor(viewSpace.top / TILE_SIZE));
+            const int chunkPixels = TileGrid::CHUNK_SIZE * TILE_SIZE;
+            sf::Vector2i chunkBegin(floor(viewSpace.left / chunkPixels), floor(viewSpace.top / chunkPixels));
             // floor: round downward.
-            sf::Vector2i tileEnd(ceil((viewSpace.left + viewSpace.width) / TILE_SIZE),
-                                 ceil((viewSpace.top + viewSpace.height) / TILE_SIZE)); // ceil: round upward.
+            sf::Vector2i chunkEnd(floor((viewSpace.left + viewSpace.width) / chunkPixels),
+                                  floor((viewSpace.top + viewSpace.height) / chunkPixels));
 
             // draw tiles.
+            sf::RenderStates states;
+            states.texture = tile_sheet_; // every tile comes from the same tile sheet.
+
             unsigned int count = 0;
-            for (int x = tileBegin.x; x <= tileEnd.x; x++)
+            for (int x = std::max(chunkBegin.x, 0); x <= chunkEnd.x; x++) // go left or up far enough?
             {
-                for (int y = tileBegin.y; y <= tileEnd.y; y++)
+                for (int y = std::max(chunkBegin.y, 0); y <= chunkEnd.y; y++)
                 {
-                    if (x < 0 || y < 0) // go left or up far enough?
+                    const sf::VertexArray* vertices = tile_grid_.GetChunkVertices(x, y);
+                    if (!vertices)
                         continue;
 
-                    Tile* tile = GetTile(x, y);
-                    if (!tile)
-                        continue;
-
-                    sf::Sprite& sprite = tile->properties_->sprite_;
-                    sprite.setPosition(x * TILE_SIZE, y * TILE_SIZE);
-                    window.draw(sprite);
-                    ++count;
+                    window.draw(*vertices, states);
+                    count += tile_grid_.GetChunkTileCount(x, y);
                 }
             }
+            tile_drawn_count_ = count;
+        }
+
+        /**
+         * \brief Number of tiles submitted by the last Draw().
+         */
+        unsigned int GetTileDrawnCount() const
+        {
+            return tile_drawn_count_;
         }
 
     private:
-        typedef std::unordered_map<TileID, Tile*> TileMap;
+        friend class Benchmarks; // builds a map in code for the allocation check.
+
         typedef std::unordered_map<TileID, TileInfo*> TileSet;
 
         TileSet tile_set_; // different types of tile.
-        TileMap tile_map_;
+        TileGrid tile_grid_; // tiles placed on the map.
         sf::Sprite background_;
         TileInfo default_tile_;
         sf::Vector2u max_map_size_;
         sf::Vector2f player_start_;
+        const sf::Texture* tile_sheet_; // texture shared by every type of tile.
+        unsigned int tile_drawn_count_;
         unsigned int tile_count_;
         unsigned int tile_set_count_;
         float map_gravity_;
         std::string next_map_;
         bool is_load_next_map_;
         std::string background_texture_; // name of background loaded from file.
+        std::future<MapData*> prefetch_; // next map being read on a worker thread.
+        std::string prefetch_path_;
         BaseState* current_state_;
         SharedContext* context_;
+        MapStreamer streamer_; // loads the chunks of a streamed map (STREAM) around the view space.
 
         /**
-         * \brief Convert 2D coordinates to 1D.
+         * \brief Read a map file into a MapData, without touching the current map.
+         * Only reads the tile set, so it can run on a worker thread.
+         * @param mapSize, gravity, defaultFriction: values kept if the file does not set them.
+         * @param decodeTextures: true: also decode the background image (the texture is created when committed).
+         * @return nullptr: if the file could not be loaded.
          */
-        unsigned int ConvertCoordinates(unsigned int x, unsigned int y)
+        MapData* ReadMapData(const std::string& path, sf::Vector2u mapSize, float gravity, sf::Vector2f defaultFriction,
+                             bool decodeTextures) const
         {
-            return (x * max_map_size_.x + y);
+            MapData* data = new MapData(mapSize, gravity, defaultFriction);
+            bool isLoaded = (MapCompiler::IsCompiledMap(path)
+                                 ? ReadMapFromBinaryFile(path, *data)
+                                 : ReadMapFromConfigFile(path, *data));
+            if (!isLoaded)
+            {
+                delete data;
+                return nullptr;
+            }
+
+            if (decodeTextures && !data->background_texture_.empty())
+            {
+                std::string texturePath = context_->texture_mgr_->GetPath(data->background_texture_);
+                data->is_background_decoded_ = !texturePath.empty() && data->background_image_.loadFromFile(
+                    Utilities::GetWorkingDirectoryA() + texturePath);
+            }
+
+            return data;
+        }
+
+        /**
+         * \brief Read a text map file, parsed by the same reader as the map compiler (see MapCompiler::ParseTextMap).
+         */
+        bool ReadMapFromConfigFile(const std::string& path, MapData& data) const
+        {
+            // the values of data are the defaults.
+            TextMap map;
+            std::memset(&map.header_, 0, sizeof(map.header_));
+            map.header_.width_ = data.map_size_.x;
+            map.header_.height_ = data.map_size_.y;
+            map.header_.gravity_ = data.gravity_;
+            map.header_.default_friction_x_ = data.default_friction_.x;
+            map.header_.default_friction_y_ = data.default_friction_.y;
+            map.stream_radius_ = data.stream_radius_;
+            map.stream_budget_ = data.stream_budget_;
+            if (!MapCompiler::ParseTextMap(Utilities::GetWorkingDirectoryA() + path, map))
+                return false;
+
+            data.map_size_ = sf::Vector2u(map.header_.width_, map.header_.height_);
+            data.tile_grid_.Resize(data.map_size_);
+            data.gravity_ = map.header_.gravity_;
+            data.default_friction_ = sf::Vector2f(map.header_.default_friction_x_, map.header_.default_friction_y_);
+            data.background_texture_ = map.background_;
+            data.next_map_ = map.next_map_;
+            data.stream_directory_ = map.stream_directory_;
+            data.stream_radius_ = map.stream_radius_;
+            data.stream_budget_ = map.stream_budget_;
+
+            for (const MapFileTile& record : map.tiles_)
+            {
+                auto itr = tile_set_.find(record.tile_id_);
+                if (itr == tile_set_.end())
+                {
+#ifdef _DEBUG
+                    std::cerr << "Tile id: " << record.tile_id_ << "was not found in tile set." << std::endl;
+#endif
+                    continue;
+                }
+
+                // tile information
+                Tile* tile = data.tile_grid_.AddTile(record.x_, record.y_, itr->second,
+                                                     (record.flags_ & MAP_FILE_TILE_WARP) != 0);
+                if (!tile)
+                {
+#ifdef _DEBUG
+                    std::cerr << "Tile is out of range or duplicate: " << record.x_ << " " << record.y_ << std::endl;
+#endif
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * \brief Read a compiled map (see MapFormat.h).
+         * The file is mapped in memory and its tile records are copied straight into the tile grid.
+         */
+        bool ReadMapFromBinaryFile(const std::string& path, MapData& data) const
+        {
+            Utilities::MappedFile file;
+            if (!file.Open(Utilities::GetWorkingDirectoryA() + path))
+            {
+#ifdef _DEBUG
+                std::cerr << "Could not load map file: " << path << std::endl;
+#endif
+                return false;
+            }
+
+            const char* fileData = file.GetData();
+            const std::size_t size = file.GetSize();
+
+            MapFileHeader header;
+            if (size < sizeof(header))
+            {
+#ifdef _DEBUG
+                std::cerr << "Bad map file: " << path << std::endl;
+#endif
+                return false;
+            }
+
+            std::memcpy(&header, fileData, sizeof(header));
+            if (std::memcmp(header.magic_, MAP_FILE_MAGIC, sizeof(MAP_FILE_MAGIC)) != 0 ||
+                header.version_ != MAP_FILE_VERSION || header.tiles_offset_ > size ||
+                (size - header.tiles_offset_) / sizeof(MapFileTile) < header.tile_count_)
+            {
+#ifdef _DEBUG
+                std::cerr << "Bad map file: " << path << std::endl;
+#endif
+                return false;
+            }
+
+            // get a string of the string block, empty if it is out of the file.
+            auto getString = [fileData, size](const MapFileString& str) -> std::string
+            {
+                if (str.offset_ > size || size - str.offset_ < str.length_)
+                    return std::string();
+                return std::string(fileData + str.offset_, str.length_);
+            };
+
+#ifdef _DEBUG
+            std::string tileSet = getString(header.tile_set_);
+            if (tileSet != "tiles.cfg")
+                std::cerr << "Map file: " << path << " was compiled for tile set: " << tileSet << std::endl;
+#endif
+
+            data.map_size_ = sf::Vector2u(header.width_, header.height_);
+            data.tile_grid_.Resize(data.map_size_);
+            data.gravity_ = header.gravity_;
+            data.default_friction_ = sf::Vector2f(header.default_friction_x_, header.default_friction_y_);
+            data.background_texture_ = getString(header.background_);
+            data.next_map_ = getString(header.next_map_);
+
+            // tile id -> tile type, avoid a hash lookup per tile record.
+            std::vector<TileInfo*> tileTypes;
+            for (auto& itr : tile_set_)
+            {
+                if (itr.first >= tileTypes.size())
+                    tileTypes.resize(itr.first + 1, nullptr);
+                tileTypes[itr.first] = itr.second;
+            }
+
+            const char* records = fileData + header.tiles_offset_;
+            for (std::uint32_t i = 0; i < header.tile_count_; i++)
+            {
+                MapFileTile record;
+                std::memcpy(&record, records + i * sizeof(MapFileTile), sizeof(MapFileTile));
+
+                TileInfo* properties = (record.tile_id_ < tileTypes.size() ? tileTypes[record.tile_id_] : nullptr);
+                if (!properties)
+                {
+#ifdef _DEBUG
+                    std::cerr << "Tile id: " << record.tile_id_ << "was not found in tile set." << std::endl;
+#endif
+                    continue;
+                }
+
+                Tile* tile = data.tile_grid_.AddTile(record.x_, record.y_, properties,
+                                                     (record.flags_ & MAP_FILE_TILE_WARP) != 0);
+                if (!tile)
+                {
+#ifdef _DEBUG
+                    std::cerr << "Bad or duplicate tile: " << record.x_ << " " << record.y_ << std::endl;
+#endif
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * \brief Make a loaded MapData the current map, then prefetch the map it links to.
+         * The tile grid is swapped, not copied.
+         */
+        void CommitMapData(MapData* data)
+        {
+            if (!data)
+                return;
+
+            max_map_size_ = data->map_size_;
+            tile_grid_.Swap(data->tile_grid_);
+            tile_count_ = tile_grid_.GetTileCount();
+            map_gravity_ = data->gravity_;
+            default_tile_.friction_ = data->default_friction_;
+            next_map_ = data->next_map_;
+            SetBackground(data->background_texture_, data->is_background_decoded_ ? &data->background_image_ : nullptr);
+            if (!data->stream_directory_.empty())
+                streamer_.Start(&tile_grid_, "media/maps/" + data->stream_directory_, data->stream_radius_,
+                                data->stream_budget_);
+            delete data;
+
+            StartPrefetch();
+        }
+
+        /**
+         * \brief Read a chunk file of a streamed map, called on a worker thread of the streamer.
+         */
+        MapData* ReadChunk(const std::string& path) const
+        {
+            return ReadMapData(path, sf::Vector2u(TileGrid::CHUNK_SIZE, TileGrid::CHUNK_SIZE), 0.0f, sf::Vector2f(),
+                               false);
+        }
+
+        /**
+         * \brief Wake up the entities which were waiting for a chunk of a streamed map.
+         */
+        void OnChunkLoaded(const sf::FloatRect& area)
+        {
+            context_->entity_mgr_->UnparkEntities(area);
+        }
+
+        /**
+         * \brief Start reading the next map (NEXTMAP) and decoding its textures on a worker thread.
+         */
+        void StartPrefetch()
+        {
+            CancelPrefetch();
+            if (next_map_.empty())
+                return;
+
+            prefetch_path_ = "media/maps/" + next_map_;
+            // arguments are copied, the worker does not read the members of the current map.
+            prefetch_ = std::async(std::launch::async, &Map::ReadMapData, this, prefetch_path_, max_map_size_,
+                                   map_gravity_, default_tile_.friction_, true);
+        }
+
+        /**
+         * \brief Get the prefetched map if it is the requested one, wait for the worker if it has not finished yet.
+         * @return nullptr: if the map was not prefetched or could not be loaded.
+         */
+        MapData* TakePrefetch(const std::string& path)
+        {
+            if (!prefetch_.valid())
+                return nullptr;
+
+            if (prefetch_path_ != path)
+            {
+                CancelPrefetch();
+                return nullptr;
+            }
+
+            prefetch_path_.clear();
+            return prefetch_.get();
+        }
+
+        /**
+         * \brief Drop the prefetched map, wait for the worker if it is still running.
+         */
+        void CancelPrefetch()
+        {
+            if (prefetch_.valid())
+                delete prefetch_.get();
+
+            prefetch_path_.clear();
+        }
+
+        /**
+         * \brief Set the background of the map.
+         * @param image: decoded image of the texture (prefetched map), nullptr: load it from its file.
+         */
+        void SetBackground(const std::string& name, const sf::Image* image = nullptr)
+        {
+            if (!background_texture_.empty() || name.empty())
+                return;
+
+            TextureManager* textureMgr = context_->texture_mgr_;
+            bool isRequired = (image && !textureMgr->GetResource(name)
+                                   ? textureMgr->RequireResource(name, textureMgr->LoadFromImage(*image))
+                                   : textureMgr->RequireResource(name));
+            if (!isRequired)
+                return;
+
+            background_texture_ = name;
+            sf::Texture* texture = textureMgr->GetResource(background_texture_);
+            background_.setTexture(*texture);
+
+            // scale the sprite enough to fit the view space fully.
+            sf::Vector2f viewSize = current_state_->GetView().getSize();
+            sf::Vector2u textureSize = texture->getSize();
+            sf::Vector2f scaleFactors;
+            scaleFactors.x = viewSize.x / textureSize.x;
+            scaleFactors.y = viewSize.y / textureSize.y;
+            background_.setScale(scaleFactors);
         }
 
         /**
@@ -367,6 +551,9 @@ namespace SFMLTutorial
                     continue;
 
                 TileInfo* tile = new TileInfo(context_, "TileSheet", tileId);
+                if (!tile_sheet_)
+                    tile_sheet_ = tile->sprite_.getTexture();
+
                 keyStream >> tile->name_ >> tile->friction_.x >> tile->friction_.y >> tile->is_deadly_;
                 if (!tile_set_.emplace(tileId, tile).second)
                 {
@@ -385,13 +572,9 @@ namespace SFMLTutorial
          */
         void PurgeMap()
         {
+            streamer_.Stop();
             tile_count_ = 0;
-            for (auto& itr : tile_map_)
-            {
-                delete itr.second;
-            }
-
-            tile_map_.clear();
+            tile_grid_.Clear();
             context_->entity_mgr_->Purge();
 
             if (background_texture_.empty())
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "pch.h"
+#include "TileGrid.h"
+#include <string>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Content of a map file, read before it becomes the current map.
+     */
+    struct MapData
+    {
+        MapData(const sf::Vector2u& mapSize, float gravity, const sf::Vector2f& defaultFriction) :
+            map_size_(mapSize), gravity_(gravity), default_friction_(defaultFriction), is_background_decoded_(false),
+            stream_radius_(1), stream_budget_(16 * 1024 * 1024)
+        {
+            tile_grid_.Resize(map_size_);
+        }
+
+        TileGrid tile_grid_;
+        sf::Vector2u map_size_;
+        float gravity_;
+        sf::Vector2f default_friction_;
+        std::string background_texture_;
+        sf::Image background_image_; // decoded background, only when is_background_decoded_.
+        bool is_background_decoded_;
+        std::string next_map_;
+        std::string stream_directory_; // not empty: the map is streamed from chunk files (see MapStreamer).
+        unsigned int stream_radius_; // chunks kept loaded around the view space.
+        std::size_t stream_budget_; // memory budget of the loaded chunks (in bytes).
+    };
+}
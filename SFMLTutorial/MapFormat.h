@@ -0,0 +1,334 @@
+#pragma once
+
+#include "TileGrid.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Layout of a compiled (binary) map file:
+     * MapFileHeader | MapFileTile[tile_count_] | string block.
+     * Everything is little-endian, offsets are in bytes from the start of the file.
+     */
+    enum MapFileFormat
+    {
+        MAP_FILE_VERSION = 1,
+        MAP_FILE_TILE_WARP = 1 << 0 // flag: the tile is a warp.
+    };
+
+    static const char MAP_FILE_MAGIC[4] = {'S', 'F', 'M', 'P'};
+    static const char MAP_FILE_EXTENSION[] = ".bmap";
+
+    /**
+     * \brief Reference to a string of the string block (not null-terminated).
+     */
+    struct MapFileString
+    {
+        std::uint32_t offset_;
+        std::uint32_t length_;
+    };
+
+    struct MapFileHeader
+    {
+        char magic_[4];
+        std::uint32_t version_;
+        std::uint32_t width_; // map size in tiles.
+        std::uint32_t height_;
+        float gravity_;
+        float default_friction_x_;
+        float default_friction_y_;
+        std::uint32_t tile_count_;
+        std::uint32_t tiles_offset_; // offset of the first MapFileTile.
+        MapFileString tile_set_; // tile set the tile ids refer to.
+        MapFileString background_;
+        MapFileString next_map_;
+    };
+
+    struct MapFileTile
+    {
+        std::uint16_t x_;
+        std::uint16_t y_;
+        std::uint16_t tile_id_;
+        std::uint16_t flags_;
+    };
+
+    static_assert(sizeof(MapFileTile) == 8, "MapFileTile must be packed");
+
+    /**
+     * \brief Content of a text map file, see MapCompiler::ParseTextMap.
+     * Fields keep the value they had before parsing if the file doesn't set them (defaults).
+     */
+    struct TextMap
+    {
+        MapFileHeader header_; // size, gravity and default friction, tile_count_ and offsets aren't set.
+        std::vector<MapFileTile> tiles_; // in file order, not checked against the size or the tile set.
+        std::string background_; // first BACKGROUND of the file.
+        std::string next_map_;
+        std::string stream_directory_; // STREAM: directory of the chunk files, relative to media/maps/.
+        unsigned int stream_radius_ = 1;
+        std::size_t stream_budget_ = 0; // in bytes, given in kilobytes by STREAM_BUDGET.
+    };
+
+    /**
+     * \brief Offline converter from the text map format to the compiled map format.
+     */
+    class MapCompiler
+    {
+    public:
+        /**
+         * \brief Compile a text map file, streamed maps (STREAM) are compiled by CompileChunks instead.
+         * @param source: path of the text map.
+         * @param destination: path of the compiled map to write.
+         * @param tileSet: name of the tile set file the tile ids refer to.
+         */
+        static bool Compile(const std::string& source, const std::string& destination,
+                            const std::string& tileSet = "tiles.cfg")
+        {
+            TextMap map;
+            if (!ParseTextMap(source, MakeDefaultTextMap(map)))
+                return false;
+
+            // a compiled map is loaded whole, the streaming settings would be lost.
+            if (!map.stream_directory_.empty())
+            {
+                std::cerr << "Streamed map, compile its chunks with --compile-chunks: " << source << std::endl;
+                return false;
+            }
+
+            std::vector<MapFileTile>& tiles = map.tiles_;
+            // store the tiles chunk by chunk, so the loader fills the tile grid one chunk at a time.
+            std::stable_sort(tiles.begin(), tiles.end(), [](const MapFileTile& first, const MapFileTile& second)
+            {
+                if (first.y_ / CHUNK_SIZE != second.y_ / CHUNK_SIZE)
+                    return first.y_ / CHUNK_SIZE < second.y_ / CHUNK_SIZE;
+                if (first.x_ / CHUNK_SIZE != second.x_ / CHUNK_SIZE)
+                    return first.x_ / CHUNK_SIZE < second.x_ / CHUNK_SIZE;
+                if (first.y_ != second.y_)
+                    return first.y_ < second.y_;
+                return first.x_ < second.x_;
+            });
+
+            return WriteMapFile(destination, map.header_, tiles, tileSet, map.background_, map.next_map_);
+        }
+
+        /**
+         * \brief Split a text map into one compiled map per chunk of the tile grid, for streamed maps (MapStreamer).
+         * Chunk files are named <x>_<y> + MAP_FILE_EXTENSION, their tile coordinates are local to the chunk.
+         * Chunks without tile get no file.
+         * @param directory: existing directory the chunk files are written to.
+         */
+        static bool CompileChunks(const std::string& source, const std::string& directory,
+                                  const std::string& tileSet = "tiles.cfg")
+        {
+            TextMap map;
+            if (!ParseTextMap(source, MakeDefaultTextMap(map)))
+                return false;
+
+            std::vector<MapFileTile>& tiles = map.tiles_;
+            MapFileHeader& header = map.header_;
+            // group the tiles by chunk.
+            std::stable_sort(tiles.begin(), tiles.end(), [](const MapFileTile& first, const MapFileTile& second)
+            {
+                if (first.y_ / CHUNK_SIZE != second.y_ / CHUNK_SIZE)
+                    return first.y_ / CHUNK_SIZE < second.y_ / CHUNK_SIZE;
+                return first.x_ / CHUNK_SIZE < second.x_ / CHUNK_SIZE;
+            });
+
+            header.width_ = CHUNK_SIZE;
+            header.height_ = CHUNK_SIZE;
+
+            auto chunkBegin = tiles.begin();
+            while (chunkBegin != tiles.end())
+            {
+                unsigned int chunkX = chunkBegin->x_ / CHUNK_SIZE;
+                unsigned int chunkY = chunkBegin->y_ / CHUNK_SIZE;
+                auto chunkEnd = std::find_if(chunkBegin, tiles.end(), [chunkX, chunkY](const MapFileTile& tile)
+                {
+                    return tile.x_ / CHUNK_SIZE != chunkX || tile.y_ / CHUNK_SIZE != chunkY;
+                });
+
+                std::vector<MapFileTile> chunkTiles(chunkBegin, chunkEnd);
+                for (auto& tile : chunkTiles)
+                {
+                    tile.x_ %= CHUNK_SIZE;
+                    tile.y_ %= CHUNK_SIZE;
+                }
+
+                std::string path = directory + "/" + std::to_string(chunkX) + "_" + std::to_string(chunkY) +
+                    MAP_FILE_EXTENSION;
+                if (!WriteMapFile(path, header, chunkTiles, tileSet, "", ""))
+                    return false;
+
+                chunkBegin = chunkEnd;
+            }
+
+            return true;
+        }
+
+        /**
+         * \brief Check whether a path names a compiled map.
+         */
+        static bool IsCompiledMap(const std::string& path)
+        {
+            const std::size_t length = sizeof(MAP_FILE_EXTENSION) - 1;
+            return (path.size() >= length && path.compare(path.size() - length, length, MAP_FILE_EXTENSION) == 0);
+        }
+
+        /**
+         * \brief Read a text map file, it's the only reader of the text format (see Map and the compilers).
+         * Tile records with coordinates or ids out of the compiled format are dropped.
+         * @param map: filled with the content of the file, fields the file doesn't set are left as they are.
+         */
+        static bool ParseTextMap(const std::string& path, TextMap& map)
+        {
+            std::ifstream ifs;
+            ifs.open(path, std::ifstream::in);
+            if (!ifs.is_open())
+            {
+#ifdef _DEBUG
+                std::cerr << "Could not load map file: " << path << std::endl;
+#endif
+                return false;
+            }
+
+            std::string line;
+            while (std::getline(ifs, line))
+            {
+                if (line[0] == '|') // ignore comment
+                    continue;
+
+                std::stringstream keyStream(line);
+                std::string type;
+                keyStream >> type;
+                if (type == "TILE")
+                {
+                    int tileId = -1;
+                    int x = -1;
+                    int y = -1;
+                    std::string warp;
+                    keyStream >> tileId >> x >> y >> warp;
+                    if (tileId < 0 || tileId > UINT16_MAX || x < 0 || x > UINT16_MAX || y < 0 || y > UINT16_MAX)
+                    {
+#ifdef _DEBUG
+                        std::cerr << "Bad tile: " << line << std::endl;
+#endif
+                        continue;
+                    }
+
+                    MapFileTile tile;
+                    tile.x_ = static_cast<std::uint16_t>(x);
+                    tile.y_ = static_cast<std::uint16_t>(y);
+                    tile.tile_id_ = static_cast<std::uint16_t>(tileId);
+                    tile.flags_ = (warp == "WARP" ? MAP_FILE_TILE_WARP : 0);
+                    map.tiles_.push_back(tile);
+                }
+                else if (type == "BACKGROUND")
+                {
+                    if (map.background_.empty())
+                        keyStream >> map.background_;
+                }
+                else if (type == "SIZE")
+                {
+                    keyStream >> map.header_.width_ >> map.header_.height_;
+                }
+                else if (type == "GRAVITY")
+                {
+                    keyStream >> map.header_.gravity_;
+                }
+                else if (type == "DEFAULT_FRICTION")
+                {
+                    keyStream >> map.header_.default_friction_x_ >> map.header_.default_friction_y_;
+                }
+                else if (type == "NEXTMAP")
+                {
+                    keyStream >> map.next_map_;
+                }
+                else if (type == "STREAM")
+                {
+                    keyStream >> map.stream_directory_;
+                }
+                else if (type == "STREAM_RADIUS")
+                {
+                    keyStream >> map.stream_radius_;
+                }
+                else if (type == "STREAM_BUDGET")
+                {
+                    std::size_t budget = 0;
+                    if (keyStream >> budget)
+                        map.stream_budget_ = budget * 1024;
+                }
+            }
+
+            ifs.close();
+            return true;
+        }
+
+    private:
+        static constexpr unsigned int CHUNK_SIZE = TileGrid::CHUNK_SIZE; // chunk files hold a chunk of the grid.
+
+        /**
+         * \brief Set a text map to the defaults of a compiled map, the same as Map.
+         */
+        static TextMap& MakeDefaultTextMap(TextMap& map)
+        {
+            std::memset(&map.header_, 0, sizeof(map.header_));
+            std::memcpy(map.header_.magic_, MAP_FILE_MAGIC, sizeof(MAP_FILE_MAGIC));
+            map.header_.version_ = MAP_FILE_VERSION;
+            map.header_.width_ = 32;
+            map.header_.height_ = 32;
+            map.header_.gravity_ = 512.0f;
+            return map;
+        }
+
+        /**
+         * \brief Write a compiled map file.
+         */
+        static bool WriteMapFile(const std::string& destination, MapFileHeader header,
+                                 const std::vector<MapFileTile>& tiles, const std::string& tileSet,
+                                 const std::string& background, const std::string& nextMap)
+        {
+            header.tile_count_ = static_cast<std::uint32_t>(tiles.size());
+            header.tiles_offset_ = sizeof(MapFileHeader);
+
+            std::uint32_t stringOffset = header.tiles_offset_ + header.tile_count_ * sizeof(MapFileTile);
+            header.tile_set_ = MakeString(tileSet, stringOffset);
+            header.background_ = MakeString(background, stringOffset);
+            header.next_map_ = MakeString(nextMap, stringOffset);
+
+            std::ofstream ofs;
+            ofs.open(destination, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+            if (!ofs.is_open())
+            {
+                std::cerr << "Could not write map file: " << destination << std::endl;
+                return false;
+            }
+
+            ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            if (!tiles.empty())
+                ofs.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(MapFileTile));
+            ofs << tileSet << background << nextMap;
+            ofs.close();
+
+            return ofs.good();
+        }
+
+        /**
+         * \brief Reserve room for a string in the string block.
+         */
+        static MapFileString MakeString(const std::string& str, std::uint32_t& offset)
+        {
+            MapFileString result;
+            result.offset_ = offset;
+            result.length_ = static_cast<std::uint32_t>(str.size());
+            offset += result.length_;
+            return result;
+        }
+    };
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "pch.h"
+#include "TileGrid.h"
+#include "MapData.h"
+#include "MapFormat.h"
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <algorithm>
+#include <math.h>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Keep the chunks of a large map loaded around the view space.
+     * Every chunk of the tile grid is a compiled map file (<directory>/<x>_<y>.bmap, tiles local to the chunk),
+     * see MapCompiler::CompileChunks. Chunks within the radius are read on worker threads,
+     * chunks out of it are kept until the memory budget is exceeded, then the least recently used are freed.
+     */
+    class MapStreamer
+    {
+    public:
+        static constexpr unsigned int MAX_PENDING_LOADS = 4; // chunks being read at the same time.
+
+        typedef std::function<MapData*(const std::string&)> ChunkReader; // read a chunk file, thread-safe.
+        typedef std::function<void(const sf::FloatRect&)> ChunkLoadedCallback; // area of the chunk in the world.
+
+        MapStreamer(const ChunkReader& reader, const ChunkLoadedCallback& onLoaded) : grid_(nullptr), radius_(1),
+                                                                                      budget_(0), memory_used_(0),
+                                                                                      reader_(reader),
+                                                                                      on_loaded_(onLoaded)
+        {
+        }
+
+        ~MapStreamer()
+        {
+            Stop();
+        }
+
+        /**
+         * \brief Start streaming chunks into a grid.
+         * @param directory: directory of the chunk files.
+         * @param radius: number of chunks kept loaded around the view space.
+         * @param budget: memory budget of the loaded chunks (in bytes).
+         */
+        void Start(TileGrid* grid, const std::string& directory, unsigned int radius, std::size_t budget)
+        {
+            Stop();
+            grid_ = grid;
+            directory_ = directory;
+            radius_ = radius;
+            budget_ = budget;
+        }
+
+        /**
+         * \brief Stop streaming, wait for the chunks being read. Loaded chunks are left in the grid.
+         */
+        void Stop()
+        {
+            for (auto& itr : pending_)
+            {
+                delete itr.second.get();
+            }
+            pending_.clear();
+            resident_.clear();
+            lru_.clear();
+            memory_used_ = 0;
+            grid_ = nullptr;
+            directory_.clear();
+        }
+
+        bool IsStreaming() const
+        {
+            return grid_ != nullptr;
+        }
+
+        /**
+         * \brief Check whether the chunk containing a world position is loaded.
+         */
+        bool IsLoaded(const sf::Vector2f& position) const
+        {
+            if (!grid_ || position.x < 0 || position.y < 0)
+                return true;
+
+            const float chunkPixels = static_cast<float>(TileGrid::CHUNK_SIZE * TILE_SIZE);
+            unsigned int chunkX = static_cast<unsigned int>(position.x / chunkPixels);
+            unsigned int chunkY = static_cast<unsigned int>(position.y / chunkPixels);
+            const sf::Vector2u& chunkCount = grid_->GetChunkCount();
+            if (chunkX >= chunkCount.x || chunkY >= chunkCount.y)
+                return true;
+
+            return resident_.find(chunkY * chunkCount.x + chunkX) != resident_.end();
+        }
+
+        /**
+         * \brief Commit the chunks which have been read, request the chunks around the view space
+         * and free the least recently used ones when over budget.
+         */
+        void Update(const sf::FloatRect& viewSpace)
+        {
+            if (!grid_)
+                return;
+
+            CommitLoadedChunks();
+
+            const sf::Vector2u& chunkCount = grid_->GetChunkCount();
+            if (chunkCount.x == 0 || chunkCount.y == 0)
+                return;
+
+            // chunks in the view space, extended by the radius.
+            const float chunkPixels = static_cast<float>(TileGrid::CHUNK_SIZE * TILE_SIZE);
+            const int radius = static_cast<int>(radius_);
+            int fromX = static_cast<int>(floor(viewSpace.left / chunkPixels)) - radius;
+            int fromY = static_cast<int>(floor(viewSpace.top / chunkPixels)) - radius;
+            int toX = static_cast<int>(floor((viewSpace.left + viewSpace.width) / chunkPixels)) + radius;
+            int toY = static_cast<int>(floor((viewSpace.top + viewSpace.height) / chunkPixels)) + radius;
+            fromX = std::max(fromX, 0);
+            fromY = std::max(fromY, 0);
+            toX = std::min(toX, static_cast<int>(chunkCount.x) - 1);
+            toY = std::min(toY, static_cast<int>(chunkCount.y) - 1);
+
+            for (int y = fromY; y <= toY; y++)
+            {
+                for (int x = fromX; x <= toX; x++)
+                {
+                    unsigned int key = y * chunkCount.x + x;
+                    auto residentItr = resident_.find(key);
+                    if (residentItr != resident_.end())
+                    {
+                        lru_.splice(lru_.begin(), lru_, residentItr->second.lru_); // most recently used.
+                        continue;
+                    }
+
+                    if (pending_.size() >= MAX_PENDING_LOADS || pending_.find(key) != pending_.end())
+                        continue;
+
+                    std::string path = directory_ + "/" + std::to_string(x) + "_" + std::to_string(y) +
+                        MAP_FILE_EXTENSION;
+                    pending_.emplace(key, std::async(std::launch::async, reader_, path));
+                }
+            }
+
+            // free the least recently used chunks, never the ones around the view space.
+            while (memory_used_ > budget_ && !lru_.empty())
+            {
+                unsigned int key = lru_.back();
+                unsigned int x = key % chunkCount.x;
+                unsigned int y = key / chunkCount.x;
+                if (static_cast<int>(x) >= fromX && static_cast<int>(x) <= toX && static_cast<int>(y) >= fromY &&
+                    static_cast<int>(y) <= toY)
+                    break;
+
+                auto residentItr = resident_.find(key);
+                memory_used_ -= residentItr->second.size_;
+                resident_.erase(residentItr);
+                lru_.pop_back();
+                grid_->RemoveChunk(x, y);
+            }
+        }
+
+        std::size_t GetMemoryUsed() const
+        {
+            return memory_used_;
+        }
+
+    private:
+        struct ResidentChunk
+        {
+            std::list<unsigned int>::iterator lru_;
+            std::size_t size_; // memory used by the chunk (in bytes).
+        };
+
+        TileGrid* grid_;
+        std::string directory_;
+        unsigned int radius_;
+        std::size_t budget_;
+        std::size_t memory_used_;
+        ChunkReader reader_;
+        ChunkLoadedCallback on_loaded_;
+
+        std::unordered_map<unsigned int, std::future<MapData*>> pending_; // chunk key -> chunk being read.
+        std::unordered_map<unsigned int, ResidentChunk> resident_; // chunk key -> loaded chunk.
+        std::list<unsigned int> lru_; // loaded chunk keys, most recently used first.
+
+        /**
+         * \brief Move the chunks read by the workers into the grid.
+         * A chunk without file is loaded as an empty chunk.
+         */
+        void CommitLoadedChunks()
+        {
+            const sf::Vector2u& chunkCount = grid_->GetChunkCount();
+            const float chunkPixels = static_cast<float>(TileGrid::CHUNK_SIZE * TILE_SIZE);
+
+            for (auto itr = pending_.begin(); itr != pending_.end();)
+            {
+                if (itr->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    ++itr;
+                    continue;
+                }
+
+                unsigned int key = itr->first;
+                unsigned int x = key % chunkCount.x;
+                unsigned int y = key / chunkCount.x;
+
+                MapData* data = itr->second.get();
+                if (data)
+                {
+                    grid_->MoveChunkFrom(data->tile_grid_, 0, 0, x, y);
+                    delete data;
+                }
+
+                lru_.push_front(key);
+                ResidentChunk chunk;
+                chunk.lru_ = lru_.begin();
+                chunk.size_ = grid_->GetChunkMemorySize(x, y);
+                resident_.emplace(key, chunk);
+                memory_used_ += chunk.size_;
+
+                itr = pending_.erase(itr);
+
+                if (on_loaded_)
+                    on_loaded_(sf::FloatRect(x * chunkPixels, y * chunkPixels, chunkPixels, chunkPixels));
+            }
+        }
+    };
+}
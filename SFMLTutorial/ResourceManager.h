@@ -68,6 +68,27 @@ namespace SFMLTutorial
             return true;
         }
 
+        /**
+         * \brief Register a resource which has already been created (e.g. from data decoded on a worker thread).
+         * The manager takes the ownership of resource, it is deleted if the resource is already loaded.
+         */
+        bool RequireResource(const std::string& id, T* resource)
+        {
+            auto existing = Find(id);
+            if (existing)
+            {
+                ++(existing->second); // increase counter
+                delete resource;
+                return true;
+            }
+
+            if (!resource)
+                return false;
+
+            resources_.emplace(id, std::make_pair(resource, 1));
+            return true;
+        }
+
         /**
          * \brief Unload resource when resource is no longer used anywhere.
          * If it is still being used somewhere, just simply decrease its counter.
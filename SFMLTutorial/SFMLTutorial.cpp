@@ -2,9 +2,65 @@
 //
 #include "Program.h"
 #include "Game.h"
+#include "MapFormat.h"
+#include "Benchmarks.h"
+#include "AllocationCounter.h"
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include <algorithm>
+
+// every heap allocation is counted, see --check-frame-allocs. operator new[] and the other forms call this one.
+void* operator new(std::size_t size)
+{
+    SFMLTutorial::AllocationCounter::Add();
+    void* memory = std::malloc(size > 0 ? size : 1);
+    if (!memory)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
 
 int main(int argc, const char* argv[])
 {
+    // offline map converter: SFMLTutorial --compile-map <text map> <compiled map>
+    if (argc == 4 && std::strcmp(argv[1], "--compile-map") == 0)
+        return (SFMLTutorial::MapCompiler::Compile(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    // streamed map chunks: SFMLTutorial --compile-chunks <text map> <existing directory>
+    if (argc == 4 && std::strcmp(argv[1], "--compile-chunks") == 0)
+        return (SFMLTutorial::MapCompiler::CompileChunks(argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    // tile lookups and drawing, tile grid against the old tile map: SFMLTutorial --bench-tiles [size in tiles]
+    if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--bench-tiles") == 0)
+    {
+        unsigned int size = (argc == 3 ? std::atoi(argv[2]) : 1024);
+        return (SFMLTutorial::Benchmarks::RunTileGrid(size) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // collision detection, grid broad phase against all pairs: SFMLTutorial --bench-entity-collision [max entities]
+    if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--bench-entity-collision") == 0)
+    {
+        unsigned int maxCount = (argc == 3 ? std::atoi(argv[2]) : 20000);
+        return (SFMLTutorial::Benchmarks::RunEntityCollision(maxCount) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // job throughput, a job per task against a loop and ParallelFor: SFMLTutorial --bench-jobs
+    if (argc == 2 && std::strcmp(argv[1], "--bench-jobs") == 0)
+        return (SFMLTutorial::Benchmarks::RunJobSystem() ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    // heap allocations per frame of a scene, none expected once warmed up: SFMLTutorial --check-frame-allocs [frames]
+    if ((argc == 2 || argc == 3) && std::strcmp(argv[1], "--check-frame-allocs") == 0)
+    {
+        unsigned int frames = (argc == 3 ? std::atoi(argv[2]) : 600);
+        return (SFMLTutorial::Benchmarks::CheckFrameAllocations(frames) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     // SFMLTutorial::Program app;
     // app.Start();
 
@@ -3,6 +3,8 @@
 #include "Window.h"
 #include "TextureManager.h"
 #include "EntityManager.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
 
 namespace SFMLTutorial
 {
@@ -11,7 +13,8 @@ namespace SFMLTutorial
     struct SharedContext
     {
         SharedContext() : window_(nullptr), event_manager_(nullptr), texture_mgr_(nullptr), game_map_(nullptr),
-                          entity_mgr_(nullptr)
+                          entity_mgr_(nullptr), job_system_(nullptr),
+                          frame_arena_(nullptr), interpolation_(1.0f)
         {
         }
 
@@ -20,5 +23,8 @@ namespace SFMLTutorial
         TextureManager* texture_mgr_;
         Map* game_map_;
         EntityManager* entity_mgr_;
+        JobSystem* job_system_; // to run work on every core, see JobSystem::ParallelFor.
+        FrameArena* frame_arena_; // memory emptied at the end of every frame (e.g. FrameVector).
+        float interpolation_; // [0, 1] position of the frame between the previous and the current simulation step.
     };
 }
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "pch.h"
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Uniform grid broad phase: boxes are bucketed by the cells they cover,
+     * only boxes sharing a cell are reported as candidate pairs.
+     * The grid is hashed, so it isn't bound to the map size and empty cells cost nothing. The cells are in an
+     * open-addressed table and their boxes in a single list of links, which keep their memory from frame to frame:
+     * once warmed up, rebuilding the grid doesn't touch the heap however far the boxes move.
+     * Boxes carry collision layers and a mask (see CollisionLayers.h), pairs which can't interact are never reported.
+     */
+    template <typename T>
+    class SpatialGrid
+    {
+    public:
+        /**
+         * @param cellCapacity: number of occupied cells the table holds before it grows, rounded to a power of two.
+         */
+        explicit SpatialGrid(float cellSize, std::size_t cellCapacity = DEFAULT_CELL_CAPACITY) :
+            cell_size_(cellSize), initial_capacity_(cellCapacity)
+        {
+            Allocate(initial_capacity_);
+        }
+
+        /**
+         * \brief Remove every box, the memory is kept to be reused by the next frame.
+         */
+        void Clear()
+        {
+            for (auto slot : used_cells_)
+            {
+                cells_[slot].head_ = NULL_LINK;
+            }
+            used_cells_.clear();
+            links_.clear();
+            items_.clear();
+        }
+
+        /**
+         * \brief Remove every box and shrink the table back to its initial size (e.g. when the map changes).
+         */
+        void Reset()
+        {
+            used_cells_.clear();
+            links_.clear();
+            items_.clear();
+            used_cells_.shrink_to_fit();
+            links_.shrink_to_fit();
+            items_.shrink_to_fit();
+            Allocate(initial_capacity_);
+        }
+
+        /**
+         * @param layers: layers of the box.
+         * @param mask: layers the box interacts with, a pair is reported if each box is on a layer of the other's mask.
+         */
+        void Insert(const T& value, const sf::FloatRect& bounds, unsigned int layers = 0xFFFFFFFF,
+                    unsigned int mask = 0xFFFFFFFF)
+        {
+            Item item;
+            item.value_ = value;
+            item.layers_ = layers;
+            item.mask_ = mask;
+            item.from_x_ = static_cast<int>(floor(bounds.left / cell_size_));
+            item.from_y_ = static_cast<int>(floor(bounds.top / cell_size_));
+            item.to_x_ = static_cast<int>(floor((bounds.left + bounds.width) / cell_size_));
+            item.to_y_ = static_cast<int>(floor((bounds.top + bounds.height) / cell_size_));
+
+            const unsigned int index = static_cast<unsigned int>(items_.size());
+            items_.emplace_back(item);
+
+            for (int y = item.from_y_; y <= item.to_y_; y++)
+            {
+                for (int x = item.from_x_; x <= item.to_x_; x++)
+                {
+                    Cell& cell = FindCell(MakeKey(x, y));
+                    Link link;
+                    link.item_ = index;
+                    link.next_ = cell.head_;
+                    cell.head_ = static_cast<unsigned int>(links_.size());
+                    links_.emplace_back(link);
+                }
+            }
+        }
+
+        /**
+         * \brief Call a function once for every pair of interacting boxes sharing at least a cell.
+         * The boxes of a pair may still not intersect, the caller does the exact test.
+         * @param function: void(const T& first, const T& second), first was inserted before second.
+         */
+        template <typename Function>
+        void ForEachPair(Function function) const
+        {
+            ForEachPairInCells(0, used_cells_.size(), function);
+        }
+
+        /**
+         * \brief Same as ForEachPair for a range of the occupied cells, see GetCellCount.
+         * Each pair belongs to a single cell, so ranges can be gone through by different threads.
+         * @param from, to: range [from, to) of the occupied cells, in the order they were first used.
+         */
+        template <typename Function>
+        void ForEachPairInCells(std::size_t from, std::size_t to, Function function) const
+        {
+            for (std::size_t c = from; c < to; c++)
+            {
+                const Cell& cell = cells_[used_cells_[c]];
+                const int cellX = static_cast<int>(static_cast<std::int32_t>(cell.key_ >> 32));
+                const int cellY = static_cast<int>(static_cast<std::int32_t>(cell.key_ & 0xFFFFFFFF));
+
+                // links go from the last box inserted in the cell to the first one.
+                for (unsigned int i = cell.head_; i != NULL_LINK; i = links_[i].next_)
+                {
+                    const Item& second = items_[links_[i].item_];
+                    for (unsigned int j = links_[i].next_; j != NULL_LINK; j = links_[j].next_)
+                    {
+                        const Item& first = items_[links_[j].item_];
+                        if (!(first.mask_ & second.layers_) || !(second.mask_ & first.layers_))
+                            continue;
+
+                        // a pair sharing several cells is only reported by the top left one.
+                        if (cellX != std::max(first.from_x_, second.from_x_) ||
+                            cellY != std::max(first.from_y_, second.from_y_))
+                            continue;
+
+                        function(first.value_, second.value_);
+                    }
+                }
+            }
+        }
+
+        /**
+         * \brief Get number of cells with at least a box.
+         */
+        std::size_t GetCellCount() const
+        {
+            return used_cells_.size();
+        }
+
+        std::size_t GetCount() const
+        {
+            return items_.size();
+        }
+
+    private:
+        struct Item
+        {
+            T value_;
+            unsigned int layers_;
+            unsigned int mask_;
+            int from_x_; // range of cells covered by the box.
+            int from_y_;
+            int to_x_;
+            int to_y_;
+        };
+
+        struct Cell
+        {
+            std::uint64_t key_;
+            unsigned int head_; // last link of the cell, NULL_LINK: the slot is free.
+        };
+
+        struct Link
+        {
+            unsigned int item_; // index of items_.
+            unsigned int next_; // link of the box inserted before in the same cell.
+        };
+
+        static constexpr unsigned int NULL_LINK = 0xFFFFFFFF;
+        static constexpr std::size_t DEFAULT_CELL_CAPACITY = 1024;
+
+        float cell_size_; // in pixels.
+        std::size_t initial_capacity_;
+        std::vector<Item> items_; // in insertion order.
+        std::vector<Cell> cells_; // open-addressed, linear probing, twice the capacity (a power of two).
+        std::vector<Link> links_; // a link per cell covered by each box.
+        std::vector<std::size_t> used_cells_; // slots of the cells with at least an item, in order of first use.
+
+        static std::uint64_t MakeKey(int x, int y)
+        {
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+        }
+
+        /**
+         * \brief Mix the bits of a key, neighbouring cells differ in their low bits only.
+         */
+        static std::size_t Hash(std::uint64_t key)
+        {
+            key ^= key >> 33;
+            key *= 0xFF51AFD7ED558CCDull;
+            key ^= key >> 33;
+            return static_cast<std::size_t>(key);
+        }
+
+        /**
+         * \brief Get the cell of a key, it's added if the key has no box yet.
+         */
+        Cell& FindCell(std::uint64_t key)
+        {
+            const std::size_t mask = cells_.size() - 1;
+            std::size_t slot = Hash(key) & mask;
+            while (cells_[slot].head_ != NULL_LINK)
+            {
+                if (cells_[slot].key_ == key)
+                    return cells_[slot];
+                slot = (slot + 1) & mask;
+            }
+
+            // keep the table at most half full, so probes stay short.
+            if ((used_cells_.size() + 1) * 2 > cells_.size())
+            {
+                Grow();
+                return FindCell(key);
+            }
+
+            cells_[slot].key_ = key;
+            used_cells_.emplace_back(slot);
+            return cells_[slot];
+        }
+
+        /**
+         * \brief Double the table, the occupied cells keep their order of first use.
+         */
+        void Grow()
+        {
+            std::vector<Cell> cells;
+            cells.swap(cells_);
+            Allocate(cells.size()); // as many cells as there were slots, so twice the slots.
+
+            const std::size_t mask = cells_.size() - 1;
+            for (auto& usedSlot : used_cells_)
+            {
+                const Cell& cell = cells[usedSlot];
+                std::size_t slot = Hash(cell.key_) & mask;
+                while (cells_[slot].head_ != NULL_LINK)
+                {
+                    slot = (slot + 1) & mask;
+                }
+                cells_[slot] = cell;
+                usedSlot = slot;
+            }
+        }
+
+        /**
+         * \brief Replace the table with an empty one for a number of cells.
+         */
+        void Allocate(std::size_t capacity)
+        {
+            std::size_t size = 2;
+            while (size < capacity * 2)
+            {
+                size *= 2;
+            }
+
+            Cell freeCell;
+            freeCell.key_ = 0;
+            freeCell.head_ = NULL_LINK;
+            cells_.assign(size, freeCell);
+            cells_.shrink_to_fit();
+        }
+    };
+}
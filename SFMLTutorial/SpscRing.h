@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief Fixed-size queue between one producer thread and one consumer thread, without lock.
+     * The producer only writes the tail and the consumer only writes the head, kept on different cache lines.
+     */
+    template <typename T, std::size_t CAPACITY>
+    class SpscRing
+    {
+    public:
+        static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of 2");
+
+        SpscRing() : head_(0), tail_(0)
+        {
+        }
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        /**
+         * \brief Add an element, only called by the producer.
+         * @return false: if the ring is full, the element isn't added.
+         */
+        bool Push(const T& element)
+        {
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) >= CAPACITY)
+                return false;
+
+            elements_[tail & MASK] = element;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * \brief Take the oldest element, only called by the consumer.
+         * @return false: if the ring is empty.
+         */
+        bool Pop(T& element)
+        {
+            std::size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_.load(std::memory_order_acquire))
+                return false;
+
+            element = elements_[head & MASK];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool IsEmpty() const
+        {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+    private:
+        static constexpr std::size_t MASK = CAPACITY - 1;
+        static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+        // padded rather than aligned, the ring may be allocated with new (no over-aligned new before C++17).
+        std::atomic<std::size_t> head_; // next element to pop.
+        char head_padding_[CACHE_LINE_SIZE - sizeof(std::atomic<std::size_t>)];
+        std::atomic<std::size_t> tail_; // next free slot.
+        char tail_padding_[CACHE_LINE_SIZE - sizeof(std::atomic<std::size_t>)];
+        T elements_[CAPACITY];
+    };
+}
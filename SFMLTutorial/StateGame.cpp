@@ -17,6 +17,7 @@ void StateGame::OnCreate()
     texture_.loadFromFile(R"(..\Res\images\Mushroom.png)");
     sprite_.setTexture(texture_);
     sprite_.setPosition(0.0f, 0.0f);
+    previous_position_ = sprite_.getPosition();
     increment_ = sf::Vector2f(400.0f, 400.0f);
 
     EventManager* eventMgr = state_mgr_->GetSharedContext()->event_manager_;
@@ -58,13 +59,19 @@ void StateGame::Update(const sf::Time& time)
         increment_.y < 0))
         increment_.y = -increment_.y;
 
+    previous_position_ = sprite_.getPosition();
     sprite_.setPosition(sprite_.getPosition() + increment_ * time.asSeconds());
 }
 
 void StateGame::Draw()
 {
     sf::RenderWindow& window = state_mgr_->GetSharedContext()->window_->GetRenderWindow();
-    window.draw(sprite_);
+
+    // draw in between the last two updates.
+    float interpolation = state_mgr_->GetSharedContext()->interpolation_;
+    sf::Sprite sprite(sprite_);
+    sprite.setPosition(previous_position_ + (sprite_.getPosition() - previous_position_) * interpolation);
+    window.draw(sprite);
 }
 
 /**
@@ -73,9 +80,11 @@ void StateGame::Draw()
 void StateGame::MainMenu(EventDetails* details)
 {
     state_mgr_->SwitchTo(StateType::MAIN_MENU);
+    state_mgr_->GetSharedContext()->window_->MarkInputShown(details);
 }
 
 void StateGame::Pause(EventDetails* details)
 {
     state_mgr_->SwitchTo(StateType::PAUSED);
+    state_mgr_->GetSharedContext()->window_->MarkInputShown(details);
 }
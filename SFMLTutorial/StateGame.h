@@ -42,6 +42,7 @@ namespace SFMLTutorial
     private:
         sf::Texture texture_;
         sf::Sprite sprite_;
+        sf::Vector2f previous_position_; // position of the sprite before the last update.
         sf::Vector2f increment_;
     };
 }
@@ -84,5 +84,6 @@ void StateIntro::Continue(EventDetails* details)
     {
         state_mgr_->SwitchTo(StateType::MAIN_MENU);
         state_mgr_->Remove(StateType::INTRO);
+        state_mgr_->GetSharedContext()->window_->MarkInputShown(details);
     }
 }
@@ -108,6 +108,7 @@ void StateMainMenu::MouseClick(EventDetails* details)
             if (i == 0)
             {
                 state_mgr_->SwitchTo(StateType::GAME); // play
+                state_mgr_->GetSharedContext()->window_->MarkInputShown(details);
             }
             else if (i == 1)
             {
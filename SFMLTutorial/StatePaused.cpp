@@ -64,4 +64,5 @@ void StatePaused::Draw()
 void StatePaused::Unpause(EventDetails* details)
 {
     state_mgr_->SwitchTo(StateType::GAME);
+    state_mgr_->GetSharedContext()->window_->MarkInputShown(details);
 }
@@ -26,6 +26,7 @@ namespace SFMLTutorial
         void Add(std::string message)
         {
             messages_.push_back(message);
+            is_content_dirty_ = true;
             if (messages_.size() < 6)
                 return;
             messages_.erase(messages_.begin()); // remove first element in vector.
@@ -33,15 +34,20 @@ namespace SFMLTutorial
 
         void Render(sf::RenderWindow& window)
         {
-            std::string content;
-            for (auto& itr : messages_)
+            // the text only changes with the messages, not every frame.
+            if (is_content_dirty_)
             {
-                content.append(itr + "\n");
+                content_string_.clear(); // keeps its memory.
+                for (auto& itr : messages_)
+                {
+                    content_string_.append(itr).append(1, '\n');
+                }
+                content_.setString(content_string_);
+                is_content_dirty_ = false;
             }
 
-            if (!content.empty())
+            if (!content_string_.empty())
             {
-                content_.setString(content);
                 window.draw(backdrop_);
                 window.draw(content_);
             }
@@ -70,10 +76,13 @@ namespace SFMLTutorial
         sf::RectangleShape backdrop_;
         sf::Font font_;
         sf::Text content_;
+        std::string content_string_; // messages joined, as set in content_.
+        bool is_content_dirty_; // have the messages changed since content_ was set?
 
         void Setup(int numberOfLinesVisible, int characterSize, int width, sf::Vector2f screenPosition)
         {
             number_of_lines_visible_ = numberOfLinesVisible;
+            is_content_dirty_ = false;
 
             // setup content
             sf::Vector2f offset(2.0f, 2.0f);
@@ -93,6 +102,7 @@ namespace SFMLTutorial
         void Clear()
         {
             messages_.clear();
+            is_content_dirty_ = true;
         }
 
         /**
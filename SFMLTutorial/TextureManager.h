@@ -30,5 +30,23 @@ namespace SFMLTutorial
 
             return texture;
         }
+
+        /**
+         * \brief Create texture from an image which has already been decoded.
+         */
+        sf::Texture* LoadFromImage(const sf::Image& image)
+        {
+            sf::Texture* texture = new sf::Texture();
+            if (!texture->loadFromImage(image))
+            {
+                delete texture;
+                texture = nullptr;
+#ifdef _DEBUG
+                std::cerr << "Could not create texture from image" << std::endl;
+#endif
+            }
+
+            return texture;
+        }
     };
 }
@@ -0,0 +1,788 @@
+#pragma once
+
+#include "pch.h"
+#include "TileInfo.h"
+#include "TileMask.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace SFMLTutorial
+{
+    struct Tile
+    {
+        TileInfo* properties_ = nullptr; // nullptr: the cell is empty.
+        bool is_warp_ = false; // is the tile a warp? (go to next level)
+    };
+
+    /**
+     * \brief Rectangle of adjacent tiles with the same properties, collided with as a single box.
+     */
+    struct TileCollider
+    {
+        sf::IntRect area_; // in tile coordinates.
+        TileInfo* properties_;
+        bool is_warp_;
+    };
+
+    /**
+     * \brief Dense storage of the tiles of a map.
+     * The map is split into square chunks of CHUNK_SIZE x CHUNK_SIZE tiles stored contiguously.
+     * A chunk is only allocated when the first tile is placed in it, empty areas cost one pointer.
+     * Every chunk caches the quads of its tiles so it can be drawn with a single draw call.
+     * Every chunk keeps a bit mask of its solid, deadly and warp cells for collision queries (see Any),
+     * and the tiles of every chunk are greedily merged into colliders, rebuilt only when a tile of the chunk changes.
+     * Colliders of neighbouring chunks spanning the same rows or columns are then joined across the chunk edges,
+     * so a floor or a wall is a single box whatever the chunks it crosses. When chunks change, only the joined
+     * colliders crossing them or their neighbours are taken apart and joined again, the others keep their index.
+     */
+    class TileGrid
+    {
+    public:
+        static constexpr unsigned int CHUNK_SIZE = 16; // tiles per side of a chunk.
+        static_assert(CHUNK_SIZE == TileMask::SIZE, "a tile mask covers a chunk");
+
+        TileGrid() : tile_count_(0), is_colliders_dirty_(true)
+        {
+        }
+
+        TileGrid(const TileGrid&) = delete;
+        TileGrid& operator=(const TileGrid&) = delete;
+
+        ~TileGrid()
+        {
+            Clear();
+        }
+
+        /**
+         * \brief Change the size of the grid (in tiles), tiles already placed are kept if they still fit.
+         */
+        void Resize(const sf::Vector2u& size)
+        {
+            sf::Vector2u chunkCount((size.x + CHUNK_SIZE - 1) / CHUNK_SIZE, (size.y + CHUNK_SIZE - 1) / CHUNK_SIZE);
+            std::vector<TileChunk*> chunks(chunkCount.x * chunkCount.y, nullptr);
+
+            // move the existing chunks to their new slot.
+            for (unsigned int y = 0; y < chunk_count_.y; y++)
+            {
+                for (unsigned int x = 0; x < chunk_count_.x; x++)
+                {
+                    TileChunk* chunk = chunks_[y * chunk_count_.x + x];
+                    if (!chunk)
+                        continue;
+
+                    if (x < chunkCount.x && y < chunkCount.y)
+                    {
+                        chunks[y * chunkCount.x + x] = chunk;
+                    }
+                    else
+                    {
+                        tile_count_ -= chunk->tile_count_;
+                        delete chunk;
+                    }
+                }
+            }
+
+            chunks_.swap(chunks);
+            chunk_count_ = chunkCount;
+            size_ = size;
+
+            // chunks on the last row and column may be cut by the new size.
+            for (unsigned int y = 0; y < chunk_count_.y; y++)
+            {
+                for (unsigned int x = 0; x < chunk_count_.x; x++)
+                {
+                    if (x + 1 == chunk_count_.x || y + 1 == chunk_count_.y)
+                        ClearChunkOutside(x, y);
+                }
+            }
+
+            // chunk indices have changed, every collider is built again.
+            colliders_.clear();
+            free_colliders_.clear();
+            detached_colliders_.clear();
+            dirty_chunks_.clear();
+            for (unsigned int i = 0; i < chunks_.size(); i++)
+            {
+                if (!chunks_[i])
+                    continue;
+
+                chunks_[i]->joined_colliders_.clear();
+                chunks_[i]->is_colliders_dirty_ = true;
+                dirty_chunks_.emplace_back(i);
+            }
+            is_colliders_dirty_ = true;
+        }
+
+        /**
+         * \brief Get tile at specific coordinates.
+         * @return nullptr: if the cell is empty or out of the grid.
+         */
+        Tile* GetTile(unsigned int x, unsigned int y)
+        {
+            if (x >= size_.x || y >= size_.y)
+                return nullptr;
+
+            TileChunk* chunk = chunks_[(y / CHUNK_SIZE) * chunk_count_.x + x / CHUNK_SIZE];
+            if (!chunk)
+                return nullptr;
+
+            Tile* tile = &chunk->tiles_[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE];
+            return (tile->properties_ ? tile : nullptr);
+        }
+
+        /**
+         * \brief Place a tile at specific coordinates.
+         * @return nullptr: if the coordinates are out of the grid or the cell is already occupied.
+         */
+        Tile* AddTile(unsigned int x, unsigned int y, TileInfo* properties, bool isWarp = false)
+        {
+            if (x >= size_.x || y >= size_.y || !properties)
+                return nullptr;
+
+            const unsigned int chunkIndex = (y / CHUNK_SIZE) * chunk_count_.x + x / CHUNK_SIZE;
+            TileChunk*& chunk = chunks_[chunkIndex];
+            if (!chunk)
+            {
+                chunk = new TileChunk();
+                dirty_chunks_.emplace_back(chunkIndex); // a new chunk is dirty already.
+            }
+
+            Tile* tile = &chunk->tiles_[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE];
+            if (tile->properties_) // duplicate tile?
+                return nullptr;
+
+            tile->properties_ = properties;
+            tile->is_warp_ = isWarp;
+            chunk->is_dirty_ = true;
+            MarkCollidersDirty(chunkIndex);
+            UpdateMask(*chunk, x % CHUNK_SIZE, y % CHUNK_SIZE);
+            ++(chunk->tile_count_);
+            ++tile_count_;
+            return tile;
+        }
+
+        /**
+         * \brief Empty the cell at specific coordinates, the chunk is freed when its last tile is removed.
+         */
+        bool RemoveTile(unsigned int x, unsigned int y)
+        {
+            Tile* tile = GetTile(x, y);
+            if (!tile)
+                return false;
+
+            *tile = Tile();
+            --tile_count_;
+
+            const unsigned int chunkIndex = (y / CHUNK_SIZE) * chunk_count_.x + x / CHUNK_SIZE;
+            TileChunk* chunk = chunks_[chunkIndex];
+            UpdateMask(*chunk, x % CHUNK_SIZE, y % CHUNK_SIZE);
+            chunk->is_dirty_ = true;
+            MarkCollidersDirty(chunkIndex);
+            if (--(chunk->tile_count_) == 0)
+                DeleteChunk(chunkIndex);
+            return true;
+        }
+
+        /**
+         * \brief Get the quads of every tile of a chunk, rebuilt only if a tile of the chunk has changed.
+         * @param chunkX, chunkY: chunk coordinates (tile coordinates / CHUNK_SIZE).
+         * @return nullptr: if the chunk has no tile or is out of the grid.
+         */
+        const sf::VertexArray* GetChunkVertices(unsigned int chunkX, unsigned int chunkY)
+        {
+            if (chunkX >= chunk_count_.x || chunkY >= chunk_count_.y)
+                return nullptr;
+
+            TileChunk* chunk = chunks_[chunkY * chunk_count_.x + chunkX];
+            if (!chunk)
+                return nullptr;
+
+            if (chunk->is_dirty_)
+                BuildChunkVertices(*chunk, chunkX, chunkY);
+
+            return &chunk->vertices_;
+        }
+
+        /**
+         * \brief Call a function for every collider overlapping a range of tile coordinates (inclusive).
+         * A collider crossing several chunks is visited once, from the first of its chunks within the range.
+         * @param function: void(const TileCollider&).
+         */
+        template <typename Function>
+        void ForEachCollider(int fromX, int fromY, int toX, int toY, Function function)
+        {
+            if (chunk_count_.x == 0 || chunk_count_.y == 0)
+                return;
+
+            if (is_colliders_dirty_)
+                BuildColliders();
+
+            const int chunkSize = static_cast<int>(CHUNK_SIZE);
+            int fromChunkX = std::max(fromX, 0) / chunkSize;
+            int fromChunkY = std::max(fromY, 0) / chunkSize;
+            int toChunkX = std::min(toX / chunkSize, static_cast<int>(chunk_count_.x) - 1);
+            int toChunkY = std::min(toY / chunkSize, static_cast<int>(chunk_count_.y) - 1);
+
+            for (int chunkY = fromChunkY; chunkY <= toChunkY; chunkY++)
+            {
+                for (int chunkX = fromChunkX; chunkX <= toChunkX; chunkX++)
+                {
+                    TileChunk* chunk = chunks_[chunkY * chunk_count_.x + chunkX];
+                    if (!chunk)
+                        continue;
+
+                    for (auto index : chunk->joined_colliders_)
+                    {
+                        const TileCollider& collider = colliders_[index];
+                        if (collider.area_.left > toX || collider.area_.left + collider.area_.width <= fromX ||
+                            collider.area_.top > toY || collider.area_.top + collider.area_.height <= fromY)
+                            continue;
+
+                        // already visited from a previous chunk of the range?
+                        if (std::max(collider.area_.left / chunkSize, fromChunkX) != chunkX ||
+                            std::max(collider.area_.top / chunkSize, fromChunkY) != chunkY)
+                            continue;
+
+                        function(collider);
+                    }
+                }
+            }
+        }
+
+        /**
+         * \brief Build the colliders of every chunk whose tiles have changed and join them across the chunk edges,
+         * afterwards ForEachCollider only reads the grid and can be called from several threads until a tile changes.
+         * Only the joined colliders crossing a changed chunk or its 4 neighbours are taken apart into the colliders
+         * of their chunks and joined again.
+         */
+        void BuildColliders()
+        {
+            if (!is_colliders_dirty_)
+                return;
+
+            // the changed chunks and their neighbours, a tile on the edge of a chunk may join a collider next to it.
+            region_.clear();
+            for (auto index : dirty_chunks_)
+            {
+                unsigned int chunkX = index % chunk_count_.x;
+                unsigned int chunkY = index / chunk_count_.x;
+                region_.emplace_back(index);
+                if (chunkX > 0)
+                    region_.emplace_back(index - 1);
+                if (chunkX + 1 < chunk_count_.x)
+                    region_.emplace_back(index + 1);
+                if (chunkY > 0)
+                    region_.emplace_back(index - chunk_count_.x);
+                if (chunkY + 1 < chunk_count_.y)
+                    region_.emplace_back(index + chunk_count_.x);
+            }
+            std::sort(region_.begin(), region_.end());
+            region_.erase(std::unique(region_.begin(), region_.end()), region_.end());
+
+            // every joined collider crossing the region is taken apart, the region gives all its chunk colliders.
+            dissolved_.assign(detached_colliders_.begin(), detached_colliders_.end());
+            pieces_.clear();
+            for (auto index : region_)
+            {
+                TileChunk* chunk = chunks_[index];
+                if (!chunk)
+                    continue;
+
+                dissolved_.insert(dissolved_.end(), chunk->joined_colliders_.begin(), chunk->joined_colliders_.end());
+                chunk->joined_colliders_.clear();
+                if (chunk->is_colliders_dirty_)
+                    BuildChunkColliders(*chunk, index % chunk_count_.x, index / chunk_count_.x);
+                pieces_.insert(pieces_.end(), chunk->colliders_.begin(), chunk->colliders_.end());
+            }
+            std::sort(dissolved_.begin(), dissolved_.end());
+            dissolved_.erase(std::unique(dissolved_.begin(), dissolved_.end()), dissolved_.end());
+
+            // out of the region, the chunk colliders a joined collider was made of lie within it.
+            for (auto dissolved : dissolved_)
+            {
+                const sf::IntRect area = colliders_[dissolved].area_;
+                ForEachChunkOf(area, [this, &area, dissolved](unsigned int index)
+                {
+                    TileChunk* chunk = chunks_[index];
+                    if (!chunk || std::binary_search(region_.begin(), region_.end(), index))
+                        return;
+
+                    std::vector<unsigned int>& joined = chunk->joined_colliders_;
+                    joined.erase(std::remove(joined.begin(), joined.end(), dissolved), joined.end());
+                    for (auto& piece : chunk->colliders_)
+                    {
+                        if (area.intersects(piece.area_))
+                            pieces_.emplace_back(piece);
+                    }
+                });
+                free_colliders_.emplace_back(dissolved);
+            }
+
+            JoinColliders(pieces_);
+
+            // every chunk refers to the colliders crossing it.
+            for (auto& piece : pieces_)
+            {
+                unsigned int index;
+                if (!free_colliders_.empty())
+                {
+                    index = free_colliders_.back();
+                    free_colliders_.pop_back();
+                    colliders_[index] = piece;
+                }
+                else
+                {
+                    index = static_cast<unsigned int>(colliders_.size());
+                    colliders_.emplace_back(piece);
+                }
+
+                ForEachChunkOf(piece.area_, [this, index](unsigned int chunkIndex)
+                {
+                    chunks_[chunkIndex]->joined_colliders_.emplace_back(index);
+                });
+            }
+
+            dirty_chunks_.clear();
+            detached_colliders_.clear();
+            is_colliders_dirty_ = false;
+        }
+
+        /**
+         * \brief Get number of tiles placed in a chunk.
+         */
+        unsigned int GetChunkTileCount(unsigned int chunkX, unsigned int chunkY) const
+        {
+            if (chunkX >= chunk_count_.x || chunkY >= chunk_count_.y)
+                return 0;
+
+            TileChunk* chunk = chunks_[chunkY * chunk_count_.x + chunkX];
+            return (chunk ? chunk->tile_count_ : 0);
+        }
+
+        /**
+         * \brief Move a whole chunk of another grid into this grid, replacing the chunk which was there.
+         * @param sourceX, sourceY: chunk coordinates in source.
+         * @param chunkX, chunkY: chunk coordinates in this grid.
+         */
+        bool MoveChunkFrom(TileGrid& source, unsigned int sourceX, unsigned int sourceY, unsigned int chunkX,
+                           unsigned int chunkY)
+        {
+            if (sourceX >= source.chunk_count_.x || sourceY >= source.chunk_count_.y || chunkX >= chunk_count_.x ||
+                chunkY >= chunk_count_.y)
+                return false;
+
+            RemoveChunk(chunkX, chunkY);
+
+            const unsigned int sourceIndex = sourceY * source.chunk_count_.x + sourceX;
+            TileChunk*& sourceChunk = source.chunks_[sourceIndex];
+            if (!sourceChunk)
+                return true;
+
+            // the joined colliders of the source stay in the source.
+            source.DetachChunk(sourceIndex);
+            source.tile_count_ -= sourceChunk->tile_count_;
+            tile_count_ += sourceChunk->tile_count_;
+            sourceChunk->is_dirty_ = true; // vertices and colliders are positioned in the world, rebuild them.
+            sourceChunk->is_colliders_dirty_ = true;
+
+            const unsigned int chunkIndex = chunkY * chunk_count_.x + chunkX;
+            chunks_[chunkIndex] = sourceChunk; // the mask of its cells comes along.
+            sourceChunk = nullptr;
+            dirty_chunks_.emplace_back(chunkIndex);
+            is_colliders_dirty_ = true;
+            if (chunkX + 1 == chunk_count_.x || chunkY + 1 == chunk_count_.y)
+                ClearChunkOutside(chunkX, chunkY); // the grid may end within the chunk.
+            return true;
+        }
+
+        /**
+         * \brief Remove every tile of a chunk and free it.
+         */
+        void RemoveChunk(unsigned int chunkX, unsigned int chunkY)
+        {
+            if (chunkX >= chunk_count_.x || chunkY >= chunk_count_.y)
+                return;
+
+            const unsigned int chunkIndex = chunkY * chunk_count_.x + chunkX;
+            TileChunk* chunk = chunks_[chunkIndex];
+            if (!chunk)
+                return;
+
+            tile_count_ -= chunk->tile_count_;
+            DeleteChunk(chunkIndex);
+        }
+
+        /**
+         * \brief Approximate memory used by a chunk, its tiles and its cached vertices (in bytes).
+         */
+        std::size_t GetChunkMemorySize(unsigned int chunkX, unsigned int chunkY) const
+        {
+            if (chunkX >= chunk_count_.x || chunkY >= chunk_count_.y)
+                return 0;
+
+            TileChunk* chunk = chunks_[chunkY * chunk_count_.x + chunkX];
+            return (chunk ? sizeof(TileChunk) + chunk->tile_count_ * 4 * sizeof(sf::Vertex) : 0);
+        }
+
+        /**
+         * \brief Exchange the content of two grids, no tile is copied.
+         */
+        void Swap(TileGrid& other)
+        {
+            chunks_.swap(other.chunks_);
+            std::swap(chunk_count_, other.chunk_count_);
+            std::swap(size_, other.size_);
+            std::swap(tile_count_, other.tile_count_);
+            colliders_.swap(other.colliders_);
+            free_colliders_.swap(other.free_colliders_);
+            detached_colliders_.swap(other.detached_colliders_);
+            dirty_chunks_.swap(other.dirty_chunks_);
+            std::swap(is_colliders_dirty_, other.is_colliders_dirty_);
+        }
+
+        /**
+         * \brief Remove every tile, the size of the grid is kept.
+         */
+        void Clear()
+        {
+            for (auto& chunk : chunks_)
+            {
+                delete chunk;
+                chunk = nullptr;
+            }
+            tile_count_ = 0;
+            colliders_.clear();
+            free_colliders_.clear();
+            detached_colliders_.clear();
+            dirty_chunks_.clear();
+            is_colliders_dirty_ = false;
+        }
+
+        /**
+         * \brief Check whether any cell of a range of tile coordinates (inclusive) is set in a layer of the masks,
+         * chunks without tile are skipped. Only reads the grid, so it can be called from several threads.
+         */
+        bool Any(TileMask::Layer layer, int fromX, int fromY, int toX, int toY) const
+        {
+            fromX = std::max(fromX, 0);
+            fromY = std::max(fromY, 0);
+            toX = std::min(toX, static_cast<int>(size_.x) - 1);
+            toY = std::min(toY, static_cast<int>(size_.y) - 1);
+            if (fromX > toX || fromY > toY)
+                return false;
+
+            const int chunkSize = static_cast<int>(CHUNK_SIZE);
+            for (int chunkY = fromY / chunkSize; chunkY <= toY / chunkSize; chunkY++)
+            {
+                for (int chunkX = fromX / chunkSize; chunkX <= toX / chunkSize; chunkX++)
+                {
+                    const TileChunk* chunk = chunks_[chunkY * chunk_count_.x + chunkX];
+                    if (!chunk)
+                        continue;
+
+                    // the range within the chunk.
+                    int left = chunkX * chunkSize;
+                    int top = chunkY * chunkSize;
+                    if (chunk->mask_.Any(layer, std::max(fromX - left, 0), std::max(fromY - top, 0),
+                                         std::min(toX - left, chunkSize - 1), std::min(toY - top, chunkSize - 1)))
+                        return true;
+                }
+            }
+            return false;
+        }
+
+        const sf::Vector2u& GetSize() const
+        {
+            return size_;
+        }
+
+        const sf::Vector2u& GetChunkCount() const
+        {
+            return chunk_count_;
+        }
+
+        unsigned int GetTileCount() const
+        {
+            return tile_count_;
+        }
+
+    private:
+        struct TileChunk
+        {
+            TileChunk() : vertices_(sf::Quads)
+            {
+            }
+
+            Tile tiles_[CHUNK_SIZE * CHUNK_SIZE]; // row-major.
+            unsigned int tile_count_ = 0; // number of occupied cells.
+            sf::VertexArray vertices_; // 4 vertices per occupied cell.
+            bool is_dirty_ = true; // has a tile changed since vertices_ was built?
+            std::vector<TileCollider> colliders_; // merged tiles of the chunk, in tile coordinates of the world.
+            bool is_colliders_dirty_ = true; // has a tile changed since colliders_ was built? (listed in dirty_chunks_)
+            std::vector<unsigned int> joined_colliders_; // indices in TileGrid::colliders_ crossing the chunk.
+            TileMask mask_; // solid, deadly and warp cells of the chunk.
+        };
+
+        std::vector<TileChunk*> chunks_; // row-major, nullptr: chunk has no tile.
+        sf::Vector2u chunk_count_;
+        sf::Vector2u size_;
+        unsigned int tile_count_;
+        std::vector<TileCollider> colliders_; // colliders of the chunks joined across the chunk edges.
+        std::vector<unsigned int> free_colliders_; // indices in colliders_ no chunk refers to.
+        std::vector<unsigned int> detached_colliders_; // joined colliders of chunks which have left the grid.
+        std::vector<unsigned int> dirty_chunks_; // chunks changed, added or removed since BuildColliders.
+        bool is_colliders_dirty_; // has a chunk changed since BuildColliders?
+        std::vector<unsigned int> region_; // used by BuildColliders, kept to reuse their memory.
+        std::vector<unsigned int> dissolved_;
+        std::vector<TileCollider> pieces_;
+
+        /**
+         * \brief Mark the colliders of a chunk out of date after one of its tiles has changed.
+         */
+        void MarkCollidersDirty(unsigned int chunkIndex)
+        {
+            TileChunk* chunk = chunks_[chunkIndex];
+            if (!chunk->is_colliders_dirty_)
+            {
+                chunk->is_colliders_dirty_ = true;
+                dirty_chunks_.emplace_back(chunkIndex);
+            }
+            is_colliders_dirty_ = true;
+        }
+
+        /**
+         * \brief Let go of the joined colliders crossing a chunk which is about to leave the grid (freed or moved).
+         */
+        void DetachChunk(unsigned int chunkIndex)
+        {
+            std::vector<unsigned int>& joined = chunks_[chunkIndex]->joined_colliders_;
+            detached_colliders_.insert(detached_colliders_.end(), joined.begin(), joined.end());
+            joined.clear();
+            dirty_chunks_.emplace_back(chunkIndex);
+            is_colliders_dirty_ = true;
+        }
+
+        void DeleteChunk(unsigned int chunkIndex)
+        {
+            DetachChunk(chunkIndex);
+            delete chunks_[chunkIndex];
+            chunks_[chunkIndex] = nullptr;
+        }
+
+        /**
+         * \brief Call a function for the index of every chunk slot an area (in tile coordinates) crosses.
+         */
+        template <typename Function>
+        void ForEachChunkOf(const sf::IntRect& area, Function function) const
+        {
+            for (unsigned int chunkY = area.top / CHUNK_SIZE; chunkY <= (area.top + area.height - 1) / CHUNK_SIZE;
+                 chunkY++)
+            {
+                for (unsigned int chunkX = area.left / CHUNK_SIZE; chunkX <= (area.left + area.width - 1) / CHUNK_SIZE;
+                     chunkX++)
+                {
+                    function(chunkY * chunk_count_.x + chunkX);
+                }
+            }
+        }
+
+        /**
+         * \brief Reflect a cell in the mask of its chunk.
+         * @param x, y: cell coordinates in the chunk.
+         */
+        static void UpdateMask(TileChunk& chunk, unsigned int x, unsigned int y)
+        {
+            const Tile& tile = chunk.tiles_[y * CHUNK_SIZE + x];
+            chunk.mask_.Set(TileMask::SOLID, x, y, tile.properties_ != nullptr);
+            chunk.mask_.Set(TileMask::DEADLY, x, y, tile.properties_ && tile.properties_->is_deadly_);
+            chunk.mask_.Set(TileMask::WARP, x, y, tile.properties_ && tile.is_warp_);
+        }
+
+        /**
+         * \brief Remove the tiles of a chunk lying out of the grid (after a resize), the chunk is freed if it's empty.
+         */
+        void ClearChunkOutside(unsigned int chunkX, unsigned int chunkY)
+        {
+            TileChunk*& chunk = chunks_[chunkY * chunk_count_.x + chunkX];
+            if (!chunk)
+                return;
+
+            for (unsigned int y = 0; y < CHUNK_SIZE; y++)
+            {
+                for (unsigned int x = 0; x < CHUNK_SIZE; x++)
+                {
+                    Tile& tile = chunk->tiles_[y * CHUNK_SIZE + x];
+                    if (!tile.properties_ || (chunkX * CHUNK_SIZE + x < size_.x && chunkY * CHUNK_SIZE + y < size_.y))
+                        continue;
+
+                    tile = Tile();
+                    UpdateMask(*chunk, x, y);
+                    --(chunk->tile_count_);
+                    --tile_count_;
+                    chunk->is_dirty_ = true;
+                }
+            }
+
+            if (chunk->tile_count_ == 0) // it's listed in dirty_chunks_ already, or colliders are reset by Resize.
+            {
+                delete chunk;
+                chunk = nullptr;
+            }
+        }
+
+        /**
+         * \brief Rebuild the cached quads of a chunk from its tiles.
+         */
+        void BuildChunkVertices(TileChunk& chunk, unsigned int chunkX, unsigned int chunkY)
+        {
+            chunk.vertices_.resize(chunk.tile_count_ * 4);
+
+            std::size_t vertex = 0;
+            for (unsigned int y = 0; y < CHUNK_SIZE; y++)
+            {
+                for (unsigned int x = 0; x < CHUNK_SIZE; x++)
+                {
+                    const Tile& tile = chunk.tiles_[y * CHUNK_SIZE + x];
+                    if (!tile.properties_)
+                        continue;
+
+                    // position of the tile in the world.
+                    float left = static_cast<float>((chunkX * CHUNK_SIZE + x) * TILE_SIZE);
+                    float top = static_cast<float>((chunkY * CHUNK_SIZE + y) * TILE_SIZE);
+                    sf::FloatRect texRect(tile.properties_->sprite_.getTextureRect());
+
+                    sf::Vertex* quad = &chunk.vertices_[vertex];
+                    quad[0].position = sf::Vector2f(left, top);
+                    quad[1].position = sf::Vector2f(left + TILE_SIZE, top);
+                    quad[2].position = sf::Vector2f(left + TILE_SIZE, top + TILE_SIZE);
+                    quad[3].position = sf::Vector2f(left, top + TILE_SIZE);
+
+                    quad[0].texCoords = sf::Vector2f(texRect.left, texRect.top);
+                    quad[1].texCoords = sf::Vector2f(texRect.left + texRect.width, texRect.top);
+                    quad[2].texCoords = sf::Vector2f(texRect.left + texRect.width, texRect.top + texRect.height);
+                    quad[3].texCoords = sf::Vector2f(texRect.left, texRect.top + texRect.height);
+                    vertex += 4;
+                }
+            }
+
+            chunk.is_dirty_ = false;
+        }
+
+        /**
+         * \brief Join colliders side by side with the same properties and the same rows (then the same columns)
+         * into one, so neighbouring chunks don't leave a seam between their colliders.
+         */
+        static void JoinColliders(std::vector<TileCollider>& colliders)
+        {
+            auto isJoinable = [](const TileCollider& first, const TileCollider& second)
+            {
+                return first.properties_ == second.properties_ && first.is_warp_ == second.is_warp_;
+            };
+
+            // along the rows: same top and height, the first ending where the second starts.
+            std::sort(colliders.begin(), colliders.end(), [](const TileCollider& first, const TileCollider& second)
+            {
+                if (first.area_.top != second.area_.top)
+                    return first.area_.top < second.area_.top;
+                if (first.area_.height != second.area_.height)
+                    return first.area_.height < second.area_.height;
+                return first.area_.left < second.area_.left;
+            });
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < colliders.size(); i++)
+            {
+                TileCollider& last = colliders[count > 0 ? count - 1 : 0];
+                const TileCollider& collider = colliders[i];
+                if (count > 0 && isJoinable(last, collider) && last.area_.top == collider.area_.top &&
+                    last.area_.height == collider.area_.height &&
+                    last.area_.left + last.area_.width == collider.area_.left)
+                    last.area_.width += collider.area_.width;
+                else
+                    colliders[count++] = collider;
+            }
+            colliders.resize(count);
+
+            // along the columns: same left and width, the first ending where the second starts.
+            std::sort(colliders.begin(), colliders.end(), [](const TileCollider& first, const TileCollider& second)
+            {
+                if (first.area_.left != second.area_.left)
+                    return first.area_.left < second.area_.left;
+                if (first.area_.width != second.area_.width)
+                    return first.area_.width < second.area_.width;
+                return first.area_.top < second.area_.top;
+            });
+            count = 0;
+            for (std::size_t i = 0; i < colliders.size(); i++)
+            {
+                TileCollider& last = colliders[count > 0 ? count - 1 : 0];
+                const TileCollider& collider = colliders[i];
+                if (count > 0 && isJoinable(last, collider) && last.area_.left == collider.area_.left &&
+                    last.area_.width == collider.area_.width &&
+                    last.area_.top + last.area_.height == collider.area_.top)
+                    last.area_.height += collider.area_.height;
+                else
+                    colliders[count++] = collider;
+            }
+            colliders.resize(count);
+        }
+
+        /**
+         * \brief Rebuild the colliders of a chunk from its tiles.
+         * Tiles with the same properties are merged greedily: a run of tiles is grown to the right,
+         * then downwards as long as every tile below the run matches.
+         */
+        void BuildChunkColliders(TileChunk& chunk, unsigned int chunkX, unsigned int chunkY)
+        {
+            chunk.colliders_.clear();
+
+            bool isMerged[CHUNK_SIZE * CHUNK_SIZE] = {};
+            auto isSame = [&chunk, &isMerged](unsigned int index, const Tile& tile)
+            {
+                const Tile& other = chunk.tiles_[index];
+                return (!isMerged[index] && other.properties_ == tile.properties_ && other.is_warp_ == tile.is_warp_);
+            };
+
+            for (unsigned int y = 0; y < CHUNK_SIZE; y++)
+            {
+                for (unsigned int x = 0; x < CHUNK_SIZE; x++)
+                {
+                    const Tile& tile = chunk.tiles_[y * CHUNK_SIZE + x];
+                    if (!tile.properties_ || isMerged[y * CHUNK_SIZE + x])
+                        continue;
+
+                    unsigned int width = 1;
+                    while (x + width < CHUNK_SIZE && isSame(y * CHUNK_SIZE + x + width, tile))
+                        ++width;
+
+                    unsigned int height = 1;
+                    while (y + height < CHUNK_SIZE)
+                    {
+                        unsigned int column = 0;
+                        while (column < width && isSame((y + height) * CHUNK_SIZE + x + column, tile))
+                            ++column;
+                        if (column < width)
+                            break;
+                        ++height;
+                    }
+
+                    for (unsigned int mergedY = y; mergedY < y + height; mergedY++)
+                    {
+                        for (unsigned int mergedX = x; mergedX < x + width; mergedX++)
+                        {
+                            isMerged[mergedY * CHUNK_SIZE + mergedX] = true;
+                        }
+                    }
+
+                    TileCollider collider;
+                    collider.area_ = sf::IntRect(chunkX * CHUNK_SIZE + x, chunkY * CHUNK_SIZE + y, width, height);
+                    collider.properties_ = tile.properties_;
+                    collider.is_warp_ = tile.is_warp_;
+                    chunk.colliders_.emplace_back(collider);
+                }
+            }
+
+            chunk.is_colliders_dirty_ = false;
+        }
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "SharedContext.h"
+#include "TextureManager.h"
+
+namespace SFMLTutorial
+{
+    enum Sheet
+    {
+        TILE_SIZE = 32,
+        SHEET_WIDTH = 256,
+        SHEET_HEIGHT = 256
+    };
+
+    typedef unsigned int TileID;
+
+    struct TileInfo
+    {
+        TileInfo(SharedContext* context, const std::string& texture = "", TileID id = 0) : id_(0), is_deadly_(false),
+                                                                                           context_(context)
+        {
+            TextureManager* textureMgr = context_->texture_mgr_;
+            if (texture.empty())
+            {
+                id_ = id;
+                return;
+            }
+
+            if (!textureMgr->RequireResource(texture))
+                return;
+
+            texture_ = texture;
+            id_ = id;
+            sprite_.setTexture(*(textureMgr->GetResource(texture_)));
+            sf::IntRect tileBoundaries(id_ % (SHEET_WIDTH / TILE_SIZE) * TILE_SIZE,
+                                       id_ / (SHEET_HEIGHT / TILE_SIZE) * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+            sprite_.setTextureRect(tileBoundaries); // crop sprite.
+        }
+
+        /**
+         * \brief Free the texture used for tile sheet.
+         */
+        ~TileInfo()
+        {
+            if (texture_.empty())
+                return;
+
+            context_->texture_mgr_->ReleaseResource(texture_);
+        }
+
+        sf::Sprite sprite_; // sprite represents the tile.
+
+        TileID id_;
+        std::string name_;
+        sf::Vector2f friction_;
+        bool is_deadly_;
+
+        SharedContext* context_;
+        std::string texture_; // texture
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+namespace SFMLTutorial
+{
+    /**
+     * \brief One bit per cell of a chunk of the tile grid for each kind of tile (solid, deadly, warp).
+     * Rows of the chunk are packed ROWS_PER_WORD to a 64-bit word, so a chunk is 4 words per layer
+     * and is allocated, moved and freed with its tiles (see TileGrid::Any for queries over the map).
+     */
+    class TileMask
+    {
+    public:
+        enum Layer
+        {
+            SOLID = 0, // any tile.
+            DEADLY,
+            WARP,
+            LAYER_COUNT
+        };
+
+        static constexpr unsigned int SIZE = 16; // cells per side, the size of a chunk.
+
+        TileMask() : bits_()
+        {
+        }
+
+        void Clear()
+        {
+            for (auto& bits : bits_)
+            {
+                std::fill(bits, bits + WORD_COUNT, 0);
+            }
+        }
+
+        /**
+         * @param x, y: cell coordinates in the chunk.
+         */
+        void Set(Layer layer, unsigned int x, unsigned int y, bool isSet)
+        {
+            if (x >= SIZE || y >= SIZE)
+                return;
+
+            std::uint64_t& word = bits_[layer][y / ROWS_PER_WORD];
+            std::uint64_t bit = std::uint64_t(1) << ((y % ROWS_PER_WORD) * SIZE + x);
+            word = (isSet ? word | bit : word & ~bit);
+        }
+
+        bool IsSet(Layer layer, unsigned int x, unsigned int y) const
+        {
+            if (x >= SIZE || y >= SIZE)
+                return false;
+
+            return ((GetRowBits(layer, y) >> x) & 1) != 0;
+        }
+
+        /**
+         * \brief Check whether any cell of a rectangle of the chunk (inclusive cell coordinates) is set,
+         * a row at a time.
+         */
+        bool Any(Layer layer, unsigned int fromX, unsigned int fromY, unsigned int toX, unsigned int toY) const
+        {
+            toX = std::min(toX, SIZE - 1);
+            toY = std::min(toY, SIZE - 1);
+            if (fromX > toX || fromY > toY)
+                return false;
+
+            const std::uint64_t columns = ((std::uint64_t(1) << (toX + 1)) - 1) & ~((std::uint64_t(1) << fromX) - 1);
+            for (unsigned int y = fromY; y <= toY; y++)
+            {
+                if (GetRowBits(layer, y) & columns)
+                    return true;
+            }
+            return false;
+        }
+
+        /**
+         * \brief Get the bits of a row of the chunk.
+         * @return bit i: cell (i, y).
+         */
+        std::uint64_t GetRowBits(Layer layer, unsigned int y) const
+        {
+            return (bits_[layer][y / ROWS_PER_WORD] >> ((y % ROWS_PER_WORD) * SIZE)) & ROW_MASK;
+        }
+
+    private:
+        static constexpr unsigned int ROWS_PER_WORD = 64 / SIZE;
+        static constexpr unsigned int WORD_COUNT = SIZE / ROWS_PER_WORD;
+        static constexpr std::uint64_t ROW_MASK = (std::uint64_t(1) << SIZE) - 1;
+
+        static_assert(SIZE <= 32 && 64 % SIZE == 0, "rows must fit a word evenly");
+
+        std::uint64_t bits_[LAYER_COUNT][WORD_COUNT]; // row-major, ROWS_PER_WORD rows per word.
+    };
+}
@@ -6,6 +6,7 @@
 #include <Shlwapi.h>
 #include <tchar.h>
 #include <string>
+#include <cstddef>
 
 namespace Utilities
 {
@@ -42,4 +43,93 @@ namespace Utilities
         }
         return "";
     }
+
+    /**
+     * \brief Read-only view of a whole file mapped in memory.
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() : file_(INVALID_HANDLE_VALUE), mapping_(nullptr), data_(nullptr), size_(0)
+        {
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile()
+        {
+            Close();
+        }
+
+        /**
+         * \brief Map the file, an empty file cannot be mapped.
+         */
+        bool Open(const std::string& path)
+        {
+            Close();
+
+            file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+            {
+                Close();
+                return false;
+            }
+
+            mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping_)
+            {
+                Close();
+                return false;
+            }
+
+            data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+            if (!data_)
+            {
+                Close();
+                return false;
+            }
+
+            size_ = static_cast<std::size_t>(size.QuadPart);
+            return true;
+        }
+
+        void Close()
+        {
+            if (data_)
+                UnmapViewOfFile(data_);
+
+            if (mapping_)
+                CloseHandle(mapping_);
+
+            if (file_ != INVALID_HANDLE_VALUE)
+                CloseHandle(file_);
+
+            file_ = INVALID_HANDLE_VALUE;
+            mapping_ = nullptr;
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+        const char* GetData() const
+        {
+            return static_cast<const char*>(data_);
+        }
+
+        std::size_t GetSize() const
+        {
+            return size_;
+        }
+
+    private:
+        HANDLE file_;
+        HANDLE mapping_;
+        const void* data_;
+        std::size_t size_;
+    };
 }
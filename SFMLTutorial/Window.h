@@ -3,6 +3,8 @@
 #include "pch.h"
 #include <string>
 #include "EventManager.h"
+#include "LatencyHistogram.h"
+#include <vector>
 
 namespace SFMLTutorial
 {
@@ -43,6 +45,31 @@ namespace SFMLTutorial
         void DisplayAfterDraw()
         {
             window_.display();
+
+            // the inputs marked this frame are on screen.
+            sf::Time now = event_manager_.GetTime();
+            for (const sf::Time& inputTime : shown_input_times_)
+            {
+                input_latency_.Add(now - inputTime);
+            }
+            shown_input_times_.clear();
+        }
+
+        /**
+         * \brief Mark the input of a callback as drawn this frame (e.g. the state it switches to),
+         * the time from the input to the display is added to the input latency when the frame is displayed.
+         */
+        void MarkInputShown(const EventDetails* details)
+        {
+            shown_input_times_.emplace_back(details->time_);
+        }
+
+        /**
+         * \brief Get the latencies from input to display of the last marked inputs (e.g. p50, p95, p99).
+         */
+        const LatencyHistogram& GetInputLatency() const
+        {
+            return input_latency_;
         }
 
         void Update()
@@ -96,6 +123,7 @@ namespace SFMLTutorial
             is_fullscreen_ = !is_fullscreen_;
             Destroy();
             Create();
+            MarkInputShown(details);
         }
 
         void Close(EventDetails* details = nullptr)
@@ -124,6 +152,8 @@ namespace SFMLTutorial
         sf::RenderWindow window_;
         sf::Vector2u window_size_;
         EventManager event_manager_;
+        LatencyHistogram input_latency_;
+        std::vector<sf::Time> shown_input_times_; // inputs whose change is drawn in the current frame.
         std::string window_title_;
         bool is_close_ = false, is_fullscreen_ = false, is_focused_ = true;
 